@@ -0,0 +1,447 @@
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "Emu8Env.h"
+
+//The emu8env Python module, a thin wrapper over the C interface in Emu8Env.h.
+//
+//    env = emu8env.VectorEnv("Chip-8 Game pack/BRIX", 256, profile="vip", frame_skip=4)
+//    env.add_register_probe(5, 1.0)
+//    observations = numpy.asarray(env.reset())                     #(256, 64, 128) uint8, no copy
+//    observations, rewards, dones = env.step(numpy.zeros(256, numpy.uint16))
+//
+//The arrays handed back are views on the environment's own buffers, every step rewrites them in place.
+
+namespace
+{
+	//A read only buffer protocol export of one of the environment's buffers. It holds a reference to the environment,
+	//so the memory stays valid for as long as anything is looking at it.
+	struct BufferView
+	{
+		PyObject_HEAD
+		PyObject* owner;
+		const void* data;
+		const char* format;
+		Py_ssize_t itemSize;
+		int dimensions;
+		Py_ssize_t shape[3];
+		Py_ssize_t strides[3];
+	};
+
+	struct VectorEnvObject
+	{
+		PyObject_HEAD
+		Emu8Env* env;
+		std::vector<uint32_t>* seeds;
+		std::vector<uint16_t>* actions;
+	};
+
+	PyTypeObject BufferViewType = {PyVarObject_HEAD_INIT(nullptr, 0) "emu8env.BufferView"};
+	PyTypeObject VectorEnvType = {PyVarObject_HEAD_INIT(nullptr, 0) "emu8env.VectorEnv"};
+
+	void BufferViewDealloc(PyObject* self)
+	{
+		Py_XDECREF(((BufferView*)self)->owner);
+		Py_TYPE(self)->tp_free(self);
+	}
+
+	int BufferViewGetBuffer(PyObject* self, Py_buffer* view, int flags)
+	{
+		BufferView* buffer = (BufferView*)self;
+
+		if(flags & PyBUF_WRITABLE)
+		{
+			PyErr_SetString(PyExc_BufferError, "emulator buffers are read only");
+			view->obj = nullptr;
+			return -1;
+		}
+
+		Py_ssize_t length = buffer->itemSize;
+		for(int i = 0; i < buffer->dimensions; i++)
+		{
+			length *= buffer->shape[i];
+		}
+
+		view->buf = (void*)buffer->data;
+		view->obj = self;
+		Py_INCREF(self);
+		view->len = length;
+		view->readonly = 1;
+		view->itemsize = buffer->itemSize;
+		view->format = (flags & PyBUF_FORMAT) ? (char*)buffer->format : nullptr;
+		view->ndim = buffer->dimensions;
+		view->shape = (flags & PyBUF_ND) ? buffer->shape : nullptr;
+		view->strides = (flags & PyBUF_STRIDES) ? buffer->strides : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+	PyBufferProcs BufferViewBufferProcs = {BufferViewGetBuffer, nullptr};
+
+	PyObject* CreateView(PyObject* owner, const void* data, const char* format, Py_ssize_t itemSize, int dimensions, const Py_ssize_t* shape)
+	{
+		BufferView* buffer = PyObject_New(BufferView, &BufferViewType);
+		if(buffer == nullptr)
+		{
+			return nullptr;
+		}
+
+		Py_INCREF(owner);
+		buffer->owner = owner;
+		buffer->data = data;
+		buffer->format = format;
+		buffer->itemSize = itemSize;
+		buffer->dimensions = dimensions;
+
+		Py_ssize_t stride = itemSize;
+		for(int i = dimensions - 1; i >= 0; i--)
+		{
+			buffer->shape[i] = shape[i];
+			buffer->strides[i] = stride;
+			stride *= shape[i];
+		}
+
+		PyObject* view = PyMemoryView_FromObject((PyObject*)buffer);
+		Py_DECREF(buffer);
+		return view;
+	}
+
+	PyObject* GetObservations(VectorEnvObject* self)
+	{
+		Py_ssize_t shape[3] = {(Py_ssize_t)emu8_env_count(self->env), 64, 128};
+		return CreateView((PyObject*)self, emu8_env_observations(self->env), "B", 1, 3, shape);
+	}
+
+	PyObject* GetRewards(VectorEnvObject* self)
+	{
+		Py_ssize_t shape[1] = {(Py_ssize_t)emu8_env_count(self->env)};
+		return CreateView((PyObject*)self, emu8_env_rewards(self->env), "f", sizeof(float), 1, shape);
+	}
+
+	PyObject* GetDones(VectorEnvObject* self)
+	{
+		Py_ssize_t shape[1] = {(Py_ssize_t)emu8_env_count(self->env)};
+		return CreateView((PyObject*)self, emu8_env_dones(self->env), "B", 1, 1, shape);
+	}
+
+	//Fills values straight from a contiguous buffer of the right item size, such as a numpy array, or else from any
+	//sequence of ints.
+	template<typename T>
+	bool ReadIntegers(PyObject* source, std::vector<T>& values)
+	{
+		Py_buffer view;
+
+		if(PyObject_CheckBuffer(source) && PyObject_GetBuffer(source, &view, PyBUF_C_CONTIGUOUS) == 0)
+		{
+			bool matches = view.itemsize == sizeof(T) && view.len == (Py_ssize_t)(values.size() * sizeof(T));
+			if(matches)
+			{
+				std::memcpy(values.data(), view.buf, view.len);
+			}
+			PyBuffer_Release(&view);
+
+			if(matches)
+			{
+				return true;
+			}
+		}
+		PyErr_Clear();
+
+		PyObject* sequence = PySequence_Fast(source, "expected a buffer or a sequence of ints");
+		if(sequence == nullptr)
+		{
+			return false;
+		}
+		if(PySequence_Fast_GET_SIZE(sequence) != (Py_ssize_t)values.size())
+		{
+			PyErr_Format(PyExc_ValueError, "expected %zu items", values.size());
+			Py_DECREF(sequence);
+			return false;
+		}
+
+		for(size_t i = 0; i < values.size(); i++)
+		{
+			unsigned long value = PyLong_AsUnsignedLong(PySequence_Fast_GET_ITEM(sequence, i));
+			if(PyErr_Occurred())
+			{
+				Py_DECREF(sequence);
+				return false;
+			}
+			values[i] = (T)value;
+		}
+		Py_DECREF(sequence);
+		return true;
+	}
+
+	PyObject* VectorEnvNew(PyTypeObject* type, PyObject*, PyObject*)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)type->tp_alloc(type, 0);
+		if(self != nullptr)
+		{
+			self->env = nullptr;
+			self->seeds = new std::vector<uint32_t>();
+			self->actions = new std::vector<uint16_t>();
+		}
+		return (PyObject*)self;
+	}
+
+	void VectorEnvDealloc(PyObject* object)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+
+		if(self->env != nullptr)
+		{
+			emu8_env_destroy(self->env);
+		}
+		delete self->seeds;
+		delete self->actions;
+		Py_TYPE(object)->tp_free(object);
+	}
+
+	int VectorEnvInit(PyObject* object, PyObject* args, PyObject* kwargs)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		const char* keywords[] = {"rom", "count", "profile", "threads", "frame_skip", "cycles_per_frame", "max_episode_frames", nullptr};
+		PyObject* romObject = nullptr;
+		unsigned int count = 0;
+		const char* profile = "vip";
+		unsigned int threads = 0;
+		unsigned int frameSkip = 1;
+		unsigned int cyclesPerFrame = 16;
+		unsigned int maxEpisodeFrames = 0;
+
+		if(!PyArg_ParseTupleAndKeywords(args, kwargs, "OI|sIIII", (char**)keywords, &romObject, &count, &profile, &threads, &frameSkip, &cyclesPerFrame, &maxEpisodeFrames))
+		{
+			return -1;
+		}
+
+		if(self->env != nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "VectorEnv is already initialised");
+			return -1;
+		}
+
+		//The ROM is either its path or its contents.
+		std::vector<unsigned char> rom;
+		if(PyUnicode_Check(romObject))
+		{
+			std::ifstream file(PyUnicode_AsUTF8(romObject), std::ios::binary);
+			if(!file)
+			{
+				PyErr_Format(PyExc_FileNotFoundError, "could not open %U", romObject);
+				return -1;
+			}
+			rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+		else
+		{
+			Py_buffer view;
+			if(PyObject_GetBuffer(romObject, &view, PyBUF_SIMPLE) != 0)
+			{
+				return -1;
+			}
+			rom.assign((unsigned char*)view.buf, (unsigned char*)view.buf + view.len);
+			PyBuffer_Release(&view);
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		self->env = emu8_env_create(rom.data(), (unsigned int)rom.size(), profile, count, threads);
+		Py_END_ALLOW_THREADS
+
+		if(self->env == nullptr)
+		{
+			PyErr_SetString(PyExc_ValueError, "could not create the environment, check the profile, count and ROM size");
+			return -1;
+		}
+
+		emu8_env_set_frame_skip(self->env, frameSkip);
+		emu8_env_set_cycles_per_frame(self->env, cyclesPerFrame);
+		emu8_env_set_max_episode_frames(self->env, maxEpisodeFrames);
+		self->seeds->resize(count);
+		self->actions->resize(count);
+		return 0;
+	}
+
+	bool CheckCreated(VectorEnvObject* self)
+	{
+		if(self->env == nullptr)
+		{
+			PyErr_SetString(PyExc_RuntimeError, "VectorEnv has not been initialised");
+			return false;
+		}
+		return true;
+	}
+
+	PyObject* VectorEnvAddMemoryProbe(PyObject* object, PyObject* args, PyObject* kwargs)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		const char* keywords[] = {"address", "length", "weight", nullptr};
+		unsigned int address = 0;
+		unsigned int length = 1;
+		float weight = 1.0f;
+
+		if(!CheckCreated(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "I|If", (char**)keywords, &address, &length, &weight))
+		{
+			return nullptr;
+		}
+		if(!emu8_env_add_memory_probe(self->env, address, length, weight))
+		{
+			PyErr_SetString(PyExc_ValueError, "a memory probe covers 1 to 4 bytes below 0x10000");
+			return nullptr;
+		}
+		Py_RETURN_NONE;
+	}
+
+	PyObject* VectorEnvAddRegisterProbe(PyObject* object, PyObject* args, PyObject* kwargs)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		const char* keywords[] = {"register", "weight", nullptr};
+		unsigned int reg = 0;
+		float weight = 1.0f;
+
+		if(!CheckCreated(self) || !PyArg_ParseTupleAndKeywords(args, kwargs, "I|f", (char**)keywords, &reg, &weight))
+		{
+			return nullptr;
+		}
+		if(!emu8_env_add_register_probe(self->env, reg, weight))
+		{
+			PyErr_SetString(PyExc_ValueError, "register probes take V0 through VF");
+			return nullptr;
+		}
+		Py_RETURN_NONE;
+	}
+
+	PyObject* VectorEnvReset(PyObject* object, PyObject* args)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		PyObject* seeds = Py_None;
+
+		if(!CheckCreated(self) || !PyArg_ParseTuple(args, "|O", &seeds))
+		{
+			return nullptr;
+		}
+		if(seeds != Py_None && !ReadIntegers(seeds, *self->seeds))
+		{
+			return nullptr;
+		}
+
+		const uint32_t* seedData = seeds != Py_None ? self->seeds->data() : nullptr;
+		Py_BEGIN_ALLOW_THREADS
+		emu8_env_reset(self->env, seedData);
+		Py_END_ALLOW_THREADS
+
+		return GetObservations(self);
+	}
+
+	PyObject* VectorEnvStep(PyObject* object, PyObject* args)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		PyObject* actions = nullptr;
+
+		if(!CheckCreated(self) || !PyArg_ParseTuple(args, "O", &actions) || !ReadIntegers(actions, *self->actions))
+		{
+			return nullptr;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		emu8_env_step(self->env, self->actions->data());
+		Py_END_ALLOW_THREADS
+
+		PyObject* observations = GetObservations(self);
+		PyObject* rewards = GetRewards(self);
+		PyObject* dones = GetDones(self);
+		if(observations == nullptr || rewards == nullptr || dones == nullptr)
+		{
+			Py_XDECREF(observations);
+			Py_XDECREF(rewards);
+			Py_XDECREF(dones);
+			return nullptr;
+		}
+		return Py_BuildValue("(NNN)", observations, rewards, dones);
+	}
+
+	PyObject* VectorEnvGetCount(PyObject* object, void*)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		return CheckCreated(self) ? PyLong_FromUnsignedLong(emu8_env_count(self->env)) : nullptr;
+	}
+
+	PyObject* VectorEnvGetObservations(PyObject* object, void*)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		return CheckCreated(self) ? GetObservations(self) : nullptr;
+	}
+
+	PyObject* VectorEnvGetRewards(PyObject* object, void*)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		return CheckCreated(self) ? GetRewards(self) : nullptr;
+	}
+
+	PyObject* VectorEnvGetDones(PyObject* object, void*)
+	{
+		VectorEnvObject* self = (VectorEnvObject*)object;
+		return CheckCreated(self) ? GetDones(self) : nullptr;
+	}
+
+	PyMethodDef VectorEnvMethods[] =
+			{
+					{"add_memory_probe", (PyCFunction)(void(*)(void))VectorEnvAddMemoryProbe, METH_VARARGS | METH_KEYWORDS, "add_memory_probe(address, length=1, weight=1.0): reward weight * change of a big endian value in memory"},
+					{"add_register_probe", (PyCFunction)(void(*)(void))VectorEnvAddRegisterProbe, METH_VARARGS | METH_KEYWORDS, "add_register_probe(register, weight=1.0): reward weight * change of V0-VF"},
+					{"reset", VectorEnvReset, METH_VARARGS, "reset(seeds=None) -> observations"},
+					{"step", VectorEnvStep, METH_VARARGS, "step(actions) -> (observations, rewards, dones), actions are 16 bit masks of held keys"},
+					{nullptr, nullptr, 0, nullptr}
+			};
+
+	PyGetSetDef VectorEnvGetSets[] =
+			{
+					{(char*)"count", VectorEnvGetCount, nullptr, (char*)"number of machines", nullptr},
+					{(char*)"observations", VectorEnvGetObservations, nullptr, (char*)"(count, 64, 128) uint8 view of the screens", nullptr},
+					{(char*)"rewards", VectorEnvGetRewards, nullptr, (char*)"(count,) float32 view of the last rewards", nullptr},
+					{(char*)"dones", VectorEnvGetDones, nullptr, (char*)"(count,) uint8 view of the last done flags", nullptr},
+					{nullptr, nullptr, nullptr, nullptr, nullptr}
+			};
+
+	PyModuleDef ModuleDefinition = {PyModuleDef_HEAD_INIT, "emu8env", "Vectorised CHIP-8 environments for reinforcement learning.", -1, nullptr};
+}
+
+PyMODINIT_FUNC PyInit_emu8env()
+{
+	BufferViewType.tp_basicsize = sizeof(BufferView);
+	BufferViewType.tp_flags = Py_TPFLAGS_DEFAULT;
+	BufferViewType.tp_dealloc = BufferViewDealloc;
+	BufferViewType.tp_as_buffer = &BufferViewBufferProcs;
+
+	VectorEnvType.tp_basicsize = sizeof(VectorEnvObject);
+	VectorEnvType.tp_flags = Py_TPFLAGS_DEFAULT;
+	VectorEnvType.tp_doc = "VectorEnv(rom, count, profile='vip', threads=0, frame_skip=1, cycles_per_frame=16, max_episode_frames=0)";
+	VectorEnvType.tp_new = VectorEnvNew;
+	VectorEnvType.tp_init = VectorEnvInit;
+	VectorEnvType.tp_dealloc = VectorEnvDealloc;
+	VectorEnvType.tp_methods = VectorEnvMethods;
+	VectorEnvType.tp_getset = VectorEnvGetSets;
+
+	if(PyType_Ready(&BufferViewType) < 0 || PyType_Ready(&VectorEnvType) < 0)
+	{
+		return nullptr;
+	}
+
+	PyObject* module = PyModule_Create(&ModuleDefinition);
+	if(module == nullptr)
+	{
+		return nullptr;
+	}
+
+	Py_INCREF(&VectorEnvType);
+	if(PyModule_AddObject(module, "VectorEnv", (PyObject*)&VectorEnvType) < 0)
+	{
+		Py_DECREF(&VectorEnvType);
+		Py_DECREF(module);
+		return nullptr;
+	}
+	return module;
+}
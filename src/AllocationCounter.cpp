@@ -0,0 +1,75 @@
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local unsigned long long allocationCount = 0;
+}
+
+#ifdef EMU8_COUNT_ALLOCATIONS
+//Replacing the global operator new means replacing its matching delete too, both go straight to malloc and free.
+void* operator new(std::size_t size)
+{
+	allocationCount++;
+	void* memory = std::malloc(size > 0 ? size : 1);
+	if(memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	allocationCount++;
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	std::free(memory);
+}
+#endif
+
+namespace Emu8
+{
+	bool AllocationCounter::IsEnabled()
+	{
+#ifdef EMU8_COUNT_ALLOCATIONS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	unsigned long long AllocationCounter::GetCount()
+	{
+		return allocationCount;
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef EMU_8_ALLOCATIONCOUNTER_H
+#define EMU_8_ALLOCATIONCOUNTER_H
+
+namespace Emu8
+{
+	//Counts the heap allocations the calling thread makes through operator new, so loops that should not allocate
+	//can check that they don't. The counting operator new is only built with EMU8_COUNT_ALLOCATIONS, which debug
+	//builds define, otherwise IsEnabled is false and the count stays at zero.
+	class AllocationCounter
+	{
+	public:
+		static bool IsEnabled();
+		static unsigned long long GetCount();
+	};
+}
+
+#endif //EMU_8_ALLOCATIONCOUNTER_H
@@ -0,0 +1,254 @@
+#include "AnalysisCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "ControlFlow.h"
+#include "Hash.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Emu8
+{
+	namespace
+	{
+		const char MAGIC[4] = {'E', '8', 'A', 'C'};
+
+		template<typename T>
+		void Append(std::vector<unsigned char>& bytes, const T* items, size_t count)
+		{
+			const unsigned char* data = (const unsigned char*)items;
+			bytes.insert(bytes.end(), data, data + count * sizeof(T));
+		}
+	}
+
+	const uint32_t AnalysisCache::VERSION;
+
+	AnalysisCache::AnalysisCache()
+			: mapping(nullptr), mappingSize(0), fallback(), header(nullptr), blocks(nullptr), successors(nullptr), jumpTargets(nullptr), instructions(nullptr), idleLoops(nullptr)
+	{
+	}
+
+	AnalysisCache::~AnalysisCache()
+	{
+		close();
+	}
+
+	std::string AnalysisCache::GetFileName(unsigned long long romHash, Profile profile)
+	{
+		return Hash::ToHex(romHash) + "-" + Profiles::GetName(profile) + ".e8ac";
+	}
+
+	bool AnalysisCache::Write(std::string filePath, unsigned long long romHash, unsigned int romSize, const ControlFlow& controlFlow, const std::vector<unsigned short>& idleLoops)
+	{
+		std::vector<Block> blocks;
+		std::vector<uint16_t> successors;
+		for(const auto& entry : controlFlow.getBlocks())
+		{
+			const BasicBlock& basicBlock = entry.second;
+			Block block = {basicBlock.start, basicBlock.end, (uint16_t)basicBlock.instructionCount, (uint16_t)basicBlock.indirectJump, (uint32_t)successors.size(), (uint32_t)basicBlock.successors.size()};
+			blocks.push_back(block);
+			successors.insert(successors.end(), basicBlock.successors.begin(), basicBlock.successors.end());
+		}
+		std::vector<uint16_t> jumpTargets(controlFlow.getLeaders().begin(), controlFlow.getLeaders().end());
+		std::vector<uint16_t> instructions(controlFlow.getInstructions().begin(), controlFlow.getInstructions().end());
+
+		std::vector<unsigned char> payload;
+		Append(payload, blocks.data(), blocks.size());
+		Append(payload, successors.data(), successors.size());
+		Append(payload, jumpTargets.data(), jumpTargets.size());
+		Append(payload, instructions.data(), instructions.size());
+		Append(payload, idleLoops.data(), idleLoops.size());
+
+		Header header = Header();
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.romHash = romHash;
+		header.romSize = romSize;
+		header.profile = (uint32_t)controlFlow.getProfile();
+		header.blockCount = (uint32_t)blocks.size();
+		header.successorCount = (uint32_t)successors.size();
+		header.jumpTargetCount = (uint32_t)jumpTargets.size();
+		header.instructionCount = (uint32_t)instructions.size();
+		header.idleLoopCount = (uint32_t)idleLoops.size();
+		header.checksum = Hash::Fnv1a(payload.data(), payload.size());
+
+		//Written beside the entry and renamed over it, so a reader never maps a half written file. Short runs of the
+		//same ROM may all write at once, so each writes its own file and the last rename wins.
+#ifdef _WIN32
+		std::string temporaryPath = filePath + "." + std::to_string(_getpid()) + ".tmp";
+#else
+		std::string temporaryPath = filePath + "." + std::to_string(getpid()) + ".tmp";
+#endif
+		{
+			std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+			out.write((const char*)&header, sizeof(header));
+			out.write((const char*)payload.data(), (std::streamsize)payload.size());
+			if(!out)
+			{
+				out.close();
+				std::remove(temporaryPath.c_str());
+				return false;
+			}
+		}
+
+#ifdef _WIN32
+		std::remove(filePath.c_str());
+#endif
+		return std::rename(temporaryPath.c_str(), filePath.c_str()) == 0;
+	}
+
+	bool AnalysisCache::open(std::string filePath, unsigned long long romHash, unsigned int romSize, Profile profile)
+	{
+		close();
+
+		const unsigned char* data = nullptr;
+		size_t size = 0;
+
+#ifdef _WIN32
+		std::ifstream in(filePath, std::ios::binary);
+		if(!in)
+		{
+			return false;
+		}
+		fallback.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		data = fallback.data();
+		size = fallback.size();
+#else
+		int descriptor = ::open(filePath.c_str(), O_RDONLY);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+
+		struct stat status;
+		if(fstat(descriptor, &status) == 0 && status.st_size > 0)
+		{
+			void* mapped = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if(mapped != MAP_FAILED)
+			{
+				mapping = mapped;
+				mappingSize = (size_t)status.st_size;
+			}
+		}
+		::close(descriptor);
+
+		data = (const unsigned char*)mapping;
+		size = mappingSize;
+#endif
+
+		//The header is followed by the block table and then the u16 arrays, so every section stays aligned.
+		if(data == nullptr || size < sizeof(Header))
+		{
+			close();
+			return false;
+		}
+
+		header = (const Header*)data;
+		const unsigned char* payload = data + sizeof(Header);
+		size_t payloadSize = size - sizeof(Header);
+		size_t expectedSize = (size_t)header->blockCount * sizeof(Block) + ((size_t)header->successorCount + header->jumpTargetCount + header->instructionCount + header->idleLoopCount) * sizeof(uint16_t);
+
+		if(std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION || header->romHash != romHash || header->romSize != romSize || header->profile != (uint32_t)profile || payloadSize != expectedSize || Hash::Fnv1a(payload, payloadSize) != header->checksum)
+		{
+			close();
+			return false;
+		}
+
+		blocks = (const Block*)payload;
+		successors = (const uint16_t*)(blocks + header->blockCount);
+		jumpTargets = successors + header->successorCount;
+		instructions = jumpTargets + header->jumpTargetCount;
+		idleLoops = instructions + header->instructionCount;
+
+		//A checksum that matches only says the file is what was written, not that its indices are sane.
+		for(uint32_t i = 0; i < header->blockCount; i++)
+		{
+			if((uint64_t)blocks[i].firstSuccessor + blocks[i].successorCount > header->successorCount)
+			{
+				close();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void AnalysisCache::close()
+	{
+#ifndef _WIN32
+		if(mapping != nullptr)
+		{
+			munmap(mapping, mappingSize);
+		}
+#endif
+		mapping = nullptr;
+		mappingSize = 0;
+		fallback.clear();
+		header = nullptr;
+		blocks = nullptr;
+		successors = nullptr;
+		jumpTargets = nullptr;
+		instructions = nullptr;
+		idleLoops = nullptr;
+	}
+
+	bool AnalysisCache::isOpen() const
+	{
+		return header != nullptr;
+	}
+
+	unsigned int AnalysisCache::getBlockCount() const
+	{
+		return header->blockCount;
+	}
+
+	const AnalysisCache::Block& AnalysisCache::getBlock(unsigned int index) const
+	{
+		return blocks[index];
+	}
+
+	const uint16_t* AnalysisCache::getSuccessors(const Block& block) const
+	{
+		return successors + block.firstSuccessor;
+	}
+
+	unsigned int AnalysisCache::getJumpTargetCount() const
+	{
+		return header->jumpTargetCount;
+	}
+
+	const uint16_t* AnalysisCache::getJumpTargets() const
+	{
+		return jumpTargets;
+	}
+
+	unsigned int AnalysisCache::getInstructionCount() const
+	{
+		return header->instructionCount;
+	}
+
+	const uint16_t* AnalysisCache::getInstructions() const
+	{
+		return instructions;
+	}
+
+	unsigned int AnalysisCache::getIdleLoopCount() const
+	{
+		return header->idleLoopCount;
+	}
+
+	const uint16_t* AnalysisCache::getIdleLoops() const
+	{
+		return idleLoops;
+	}
+}
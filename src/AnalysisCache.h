@@ -0,0 +1,92 @@
+#ifndef EMU_8_ANALYSISCACHE_H
+#define EMU_8_ANALYSISCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Quirks.h"
+
+namespace Emu8
+{
+	class ControlFlow;
+
+	//What is known about a ROM that can be worked out once and kept: its basic blocks, the addresses control is
+	//transferred to, every address reached as an instruction, and the idle loops seen while it ran. Entries live in a cache directory, one file per ROM
+	//content hash and profile, and are mapped straight into memory when read.
+	//
+	//File layout, in host byte order since a cache never leaves the machine that wrote it:
+	//
+	//    Header, Block[blockCount], u16 successors[successorCount], u16 jumpTargets[jumpTargetCount],
+	//    u16 instructions[instructionCount], u16 idleLoops[idleLoopCount]
+	//
+	//An entry is only used if its magic, version, ROM hash, ROM size and profile all match and the payload hashes
+	//to the checksum in the header, anything else is treated as a miss and rewritten.
+	class AnalysisCache
+	{
+	public:
+		static const uint32_t VERSION = 1;
+
+		struct Header
+		{
+			char magic[4]; //"E8AC"
+			uint32_t version;
+			uint64_t romHash;
+			uint32_t romSize;
+			uint32_t profile;
+			uint32_t blockCount;
+			uint32_t successorCount;
+			uint32_t jumpTargetCount;
+			uint32_t instructionCount;
+			uint32_t idleLoopCount;
+			uint64_t checksum; //FNV-1a of everything after the header.
+		};
+
+		struct Block
+		{
+			uint16_t start;
+			uint16_t end;
+			uint16_t instructionCount;
+			uint16_t indirectJump;
+			uint32_t firstSuccessor;
+			uint32_t successorCount;
+		};
+
+	private:
+		void* mapping;
+		size_t mappingSize;
+		std::vector<unsigned char> fallback; //Holds the file where it can't be mapped.
+		const Header* header;
+		const Block* blocks;
+		const uint16_t* successors;
+		const uint16_t* jumpTargets;
+		const uint16_t* instructions;
+		const uint16_t* idleLoops;
+
+		AnalysisCache(const AnalysisCache& other);
+		AnalysisCache& operator=(const AnalysisCache& other);
+
+		bool validate(unsigned long long romHash, unsigned int romSize, Profile profile);
+
+	public:
+		static std::string GetFileName(unsigned long long romHash, Profile profile);
+		static bool Write(std::string filePath, unsigned long long romHash, unsigned int romSize, const ControlFlow& controlFlow, const std::vector<unsigned short>& idleLoops);
+
+		AnalysisCache();
+		~AnalysisCache();
+		bool open(std::string filePath, unsigned long long romHash, unsigned int romSize, Profile profile);
+		void close();
+		bool isOpen() const;
+		unsigned int getBlockCount() const;
+		const Block& getBlock(unsigned int index) const;
+		const uint16_t* getSuccessors(const Block& block) const;
+		unsigned int getJumpTargetCount() const;
+		const uint16_t* getJumpTargets() const;
+		unsigned int getInstructionCount() const;
+		const uint16_t* getInstructions() const;
+		unsigned int getIdleLoopCount() const;
+		const uint16_t* getIdleLoops() const;
+	};
+}
+
+#endif //EMU_8_ANALYSISCACHE_H
@@ -0,0 +1,49 @@
+#ifndef EMU_8_AOTABI_H
+#define EMU_8_AOTABI_H
+
+#include "MachineState.h"
+#include "Quirks.h"
+
+//The interface between the core and a module generated by emu8_aot. Modules are compiled against MachineState.h, so any
+//change to MachineState has to bump the version.
+#define EMU8_AOT_ABI_VERSION 3
+
+#ifdef _WIN32
+#define EMU8_AOT_EXPORT extern "C" __declspec(dllexport)
+#else
+#define EMU8_AOT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+namespace Emu8
+{
+	struct AotContext
+	{
+		MachineState* state;
+		void* machine;
+		//Runs a single instruction through the interpreter, for everything a module does not translate itself.
+		void (*interpret)(void* machine, unsigned short instruction);
+		//Set when a block ends in a short backwards jump that may be a polling loop.
+		bool idleCandidate;
+	};
+
+	//Runs the translated block starting at the program counter and returns how many instructions it executed.
+	//Returns zero when there is no block there or the block needs more cycles than are left.
+	typedef unsigned int (*AotRunner)(AotContext* context, unsigned int cyclesLeft);
+
+	struct AotModuleInfo
+	{
+		unsigned int abiVersion;
+		unsigned long long romHash;
+		Profile profile;
+		unsigned short codeStart;
+		unsigned short codeEnd;
+		const unsigned char* codeMap; //One bit per byte of translated code from codeStart on.
+		AotRunner run;
+	};
+}
+
+#define EMU8_AOT_ENTRY_POINT "Emu8AotGetModule"
+
+typedef const Emu8::AotModuleInfo* (*Emu8AotGetModuleFunction)();
+
+#endif //EMU_8_AOTABI_H
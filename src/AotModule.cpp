@@ -0,0 +1,102 @@
+#include "AotModule.h"
+#include <string>
+#include "Console.h"
+#include "Hash.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace Emu8
+{
+	AotModule::AotModule()
+			: handle(nullptr), info(nullptr)
+	{
+	}
+
+	AotModule::~AotModule()
+	{
+		close();
+	}
+
+	bool AotModule::open(std::string filePath)
+	{
+		close();
+
+#ifdef _WIN32
+		handle = (void*)LoadLibraryA(filePath.c_str());
+		Emu8AotGetModuleFunction getModule = handle == nullptr ? nullptr : (Emu8AotGetModuleFunction)GetProcAddress((HMODULE)handle, EMU8_AOT_ENTRY_POINT);
+#else
+		handle = dlopen(filePath.c_str(), RTLD_NOW | RTLD_LOCAL);
+		Emu8AotGetModuleFunction getModule = handle == nullptr ? nullptr : (Emu8AotGetModuleFunction)dlsym(handle, EMU8_AOT_ENTRY_POINT);
+#endif
+
+		if(getModule == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		info = getModule();
+
+		if(info == nullptr || info->abiVersion != EMU8_AOT_ABI_VERSION)
+		{
+			Console::Print("Ignoring " + filePath + ", it was built for a different module version.");
+			close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void AotModule::close()
+	{
+		if(handle != nullptr)
+		{
+#ifdef _WIN32
+			FreeLibrary((HMODULE)handle);
+#else
+			dlclose(handle);
+#endif
+			handle = nullptr;
+		}
+
+		info = nullptr;
+	}
+
+	const AotModuleInfo* AotModule::getInfo() const
+	{
+		return info;
+	}
+
+	bool AotModule::containsCode(unsigned short address, unsigned int length) const
+	{
+		for(unsigned int i = 0; i < length; i++)
+		{
+			unsigned int byte = (unsigned short)(address + i);
+
+			if(byte >= info->codeStart && byte < info->codeEnd)
+			{
+				unsigned int offset = byte - info->codeStart;
+
+				if(info->codeMap[offset / 8] & (1 << (offset % 8)))
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	std::string AotModule::GetFileName(unsigned long long romHash)
+	{
+#ifdef _WIN32
+		return Hash::ToHex(romHash) + ".dll";
+#else
+		return Hash::ToHex(romHash) + ".so";
+#endif
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef EMU_8_AOTMODULE_H
+#define EMU_8_AOTMODULE_H
+
+#include <string>
+#include "AotAbi.h"
+
+namespace Emu8
+{
+	//A shared library produced from emu8_aot output.
+	class AotModule
+	{
+	private:
+		void* handle;
+		const AotModuleInfo* info;
+
+		AotModule(const AotModule& other);
+		AotModule& operator=(const AotModule& other);
+
+	public:
+		AotModule();
+		~AotModule();
+		bool open(std::string filePath);
+		void close();
+		const AotModuleInfo* getInfo() const;
+		bool containsCode(unsigned short address, unsigned int length) const;
+
+		static std::string GetFileName(unsigned long long romHash);
+	};
+}
+
+#endif //EMU_8_AOTMODULE_H
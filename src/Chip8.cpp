@@ -1,23 +1,50 @@
 #include "Chip8.h"
+#include <algorithm>
 #include <array>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <random>
-#include <SDL_ttf.h>
-#include <stack>
 #include <string>
+#include "AllocationCounter.h"
+#include "AnalysisCache.h"
+#include "AotModule.h"
 #include "Console.h"
+#include "ControlFlow.h"
 #include "Display.h"
+#include "HudFont.h"
+#include "Session.h"
 #include "Time.h"
-#include "File.h"
 
-const unsigned int SCREEN_WIDTH = 64;
-const unsigned int SCREEN_HEIGHT = 32;
+#ifdef EMU8_SDL_TTF
+#include <SDL_ttf.h>
+#endif
+
+const unsigned int SCREEN_WIDTH = Emu8::Framebuffer::MAX_WIDTH;
+const unsigned int SCREEN_HEIGHT = Emu8::Framebuffer::MAX_HEIGHT;
+const unsigned int FRAMES_PER_SECOND = 60;
+const unsigned int OVERLAY_SCALE = 2;
+
+//Taken while static objects are constructed, which is as close to process start as portable code gets.
+const std::chrono::steady_clock::time_point PROCESS_START = std::chrono::steady_clock::now();
+
+namespace
+{
+	//Ctrl-C ends a run in the terminal the normal way, so the terminal is put back as it was.
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void RequestStop(int)
+	{
+		stopRequested = 1;
+	}
+}
 
 namespace Emu8
 {
 	Chip8::Chip8()
-			: isRunning(true), mainMem(), stackMem(), vReg(), displayArray(), keyInputs(), iRegister(), delayRegister(), soundRegister(), programCounter(512), inputEvent(), screenSurface(nullptr), stopProcessing(false), regX(), time(), fpsFont(nullptr)
+			: isRunning(true), headless(false), headlessFrames(0), initDone(), loadDone(), machine(), keypadState(0), keymap(), inputLatency(), inputEvent(), screenSurface(nullptr), time(FRAMES_PER_SECOND), fpsFont(nullptr), fpsSurface(nullptr), fpsSurfaceText(), overlayText(), framesRun(0), allocationReported(false), debugger(), recorder(), sharedExport(), phosphor(), usePhosphor(false), cacheDirectory(), cachedRom(), cachedIdleLoops(), analysisStale(false), netplayTransport(), rollback(), terminal(), useTerminal(false), terminalMode(TerminalMode::HalfBlocks), terminalRefreshRate(30)
 	{
 	}
 
@@ -25,6 +52,7 @@ namespace Emu8
 	{
 		Console::Print("Shutting down emulator.");
 
+		SaveAnalysisCache();
 		release();
 
 		Console::Print("Goodbye...");
@@ -32,18 +60,50 @@ namespace Emu8
 
 	bool Chip8::init()
 	{
-		Console::Print("Initializing SDL2...");
-		if(SDL_Init(SDL_INIT_EVERYTHING) < 0)
+		//EMU8_TERMINAL=<blocks|braille>[:<refreshes per second>] draws into the terminal instead of a window, for machines
+		//without a display. It runs in real time like the window does, but without input, and brings up nothing of SDL.
+		const char* terminalSetting = std::getenv("EMU8_TERMINAL");
+		if(terminalSetting != nullptr)
 		{
-			Console::Print("SDL2 failed to init!");
-			return false;
+			std::string setting = terminalSetting;
+			std::string::size_type colon = setting.find(':');
+			if(!TerminalDisplay::ParseMode(setting.substr(0, colon), terminalMode))
+			{
+				Console::Print("EMU8_TERMINAL needs blocks or braille, optionally followed by :<refreshes per second>.");
+				return false;
+			}
+			if(colon != std::string::npos)
+			{
+				terminalRefreshRate = (unsigned int)std::atoi(setting.substr(colon + 1).c_str());
+			}
+
+			useTerminal = true;
+			headless = true;
+			initDone = std::chrono::steady_clock::now();
+			return true;
 		}
-		if(TTF_Init() < 0)
+
+		//EMU8_HEADLESS=<frames> runs without a window or input, as fast as the machine goes, until it halts or has
+		//run that many frames. Nothing of SDL is brought up at all.
+		const char* headlessSetting = std::getenv("EMU8_HEADLESS");
+		if(headlessSetting != nullptr)
 		{
-			Console::Print("SDL2_ttf failed to init!");
+			headless = true;
+			headlessFrames = std::strtoull(headlessSetting, nullptr, 10);
+			initDone = std::chrono::steady_clock::now();
+			return true;
+		}
+
+		//Video brings up events with it, and ticks and delays work without a subsystem of their own.
+		Console::Print("Initializing SDL2...");
+		if(SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			Console::Print("SDL2 failed to init!");
 			return false;
 		}
 
+		LoadKeymap(keymap);
+
 		Console::Print("Creating Display...");
 		if(!Display::Create(1280, 720))
 		{
@@ -51,52 +111,186 @@ namespace Emu8
 			return false;
 		}
 
-		if((fpsFont = TTF_OpenFont("Data/Fonts/arial.ttf", 16)) == nullptr)
+#ifdef EMU8_SDL_TTF
+		//The built in bitmap font is used whenever the TrueType one can't be loaded.
+		if(TTF_Init() < 0 || (fpsFont = TTF_OpenFont("Data/Fonts/arial.ttf", 16)) == nullptr)
 		{
-			Console::Print("Failed to load font!");
-			return false;
+			Console::Print("Failed to load font, using the built in one.");
 		}
+#endif
 
 		SDL_Surface* tempSurface = SDL_CreateRGBSurface(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, 0, 0, 0, 0);
 		SDL_Surface* optimizedSurface = SDL_ConvertSurface(tempSurface, Display::GetWindowSurface()->format, 0);
 		screenSurface = optimizedSurface;
 		SDL_FreeSurface(tempSurface);
 
-		loadFontData();
+		//EMU8_PHOSPHOR=<frames> lets pixels fade out over that many frames instead of vanishing when erased. The
+		//compositor works on 32 bit pixels, which is what every window surface SDL2 hands out in practice uses.
+		const char* phosphorFrames = std::getenv("EMU8_PHOSPHOR");
+		if(phosphorFrames != nullptr && screenSurface->format->BytesPerPixel == 4)
+		{
+			phosphor.setDecayFrames(std::atoi(phosphorFrames));
+			phosphor.setPalette({SDL_MapRGB(screenSurface->format, 0, 0, 0), SDL_MapRGB(screenSurface->format, 255, 255, 255), SDL_MapRGB(screenSurface->format, 170, 170, 170), SDL_MapRGB(screenSurface->format, 255, 0, 0)});
+			usePhosphor = true;
+		}
 
+		initDone = std::chrono::steady_clock::now();
 		return true;
 	}
 
 	void Chip8::release()
 	{
+		if(headless)
+		{
+			return;
+		}
+
 		Display::Destroy();
-		TTF_CloseFont(fpsFont);
-		TTF_Quit();
+#ifdef EMU8_SDL_TTF
+		SDL_FreeSurface(fpsSurface);
+		fpsSurface = nullptr;
+		if(fpsFont != nullptr)
+		{
+			TTF_CloseFont(fpsFont);
+			fpsFont = nullptr;
+		}
+		if(TTF_WasInit())
+		{
+			TTF_Quit();
+		}
+#endif
 		SDL_FreeSurface(screenSurface);
+		screenSurface = nullptr;
 		SDL_Quit();
 	}
 
-	void Chip8::loadGame(std::string filePath)
+	bool Chip8::loadGame(std::string filePath, Profile profile)
 	{
-		File file = File(filePath);
-		file.open();
-		file.readAll((char*)(&mainMem[512]));
-		file.close();
+		Console::Print("Loading " + filePath + " as " + Profiles::GetName(profile) + "...");
+
+		machine = Machine::Create(profile);
+		machine->setDebugger(&debugger);
+
+		if(!machine->loadGame(filePath))
+		{
+			return false;
+		}
+
+		//Use an emu8_aot translation of this ROM if one has been built.
+		const char* aotDirectory = std::getenv("EMU8_AOT_DIR");
+		if(aotDirectory != nullptr && machine->loadAotModule(std::string(aotDirectory) + "/" + AotModule::GetFileName(machine->getRomHash())))
+		{
+			Console::Print("Running translated code for " + filePath + ".");
+		}
+
+		//EMU8_CACHE_DIR keeps what was learned about each ROM between runs, see LoadAnalysisCache.
+		const char* cacheSetting = std::getenv("EMU8_CACHE_DIR");
+		if(cacheSetting != nullptr)
+		{
+			cacheDirectory = cacheSetting;
+			LoadAnalysisCache();
+		}
+
+		//Record the session if asked to, at the native resolution of the profile.
+		const char* recordingPath = std::getenv("EMU8_RECORD");
+		RecordingFormat format;
+		if(recordingPath != nullptr && Recorder::FormatFromFileName(recordingPath, format))
+		{
+			bool hiRes = profile == Profile::SuperChip || profile == Profile::XoChip;
+			recorder.open(recordingPath, format, hiRes ? Framebuffer::MAX_WIDTH : Framebuffer::MAX_WIDTH / 2, hiRes ? Framebuffer::MAX_HEIGHT : Framebuffer::MAX_HEIGHT / 2, FRAMES_PER_SECOND);
+		}
+		else if(recordingPath != nullptr)
+		{
+			Console::Print("Can't record to " + std::string(recordingPath) + ", use a .y4m, .raw or .e8rl file.");
+		}
 
-		/*std::ifstream file;
-		file.open(filePath, std::ios::out | std::ios::binary | std::ios::ate);
+		//Publish every frame to shared memory so other processes can watch, see tools/Viewer.cpp.
+		const char* sharedName = std::getenv("EMU8_SHARED");
+		if(sharedName != nullptr && sharedExport.create(sharedName))
+		{
+			Console::Print("Sharing the machine as " + std::string(SharedExport::NAME_PREFIX) + sharedName + ".");
+		}
 
-		if(file.is_open())
+		//EMU8_NETPLAY=<local port>:<remote host>:<remote port> shares the keypad with another Emu-8 running the same ROM
+		//over UDP, see Rollback. EMU8_ROLLBACK=<frames> is how far it may run ahead of the other side, 8 by default.
+		const char* netplaySetting = std::getenv("EMU8_NETPLAY");
+		if(netplaySetting != nullptr)
 		{
-			int fileSize = (int)file.tellg();
-			file.seekg(0, std::ios::beg);
-			file.read((char*)(&mainMem[512]), fileSize);
-			file.close();
-		}//*/
+			std::string setting = netplaySetting;
+			std::string::size_type first = setting.find(':');
+			std::string::size_type last = setting.rfind(':');
+			const char* rollbackSetting = std::getenv("EMU8_ROLLBACK");
+
+			if(first == std::string::npos || first == last)
+			{
+				Console::Print("EMU8_NETPLAY needs <local port>:<remote host>:<remote port>.");
+			}
+			else if(netplayTransport.open((unsigned short)std::atoi(setting.substr(0, first).c_str()), setting.substr(first + 1, last - first - 1), (unsigned short)std::atoi(setting.substr(last + 1).c_str())))
+			{
+				rollback.reset(new Rollback(*machine, netplayTransport, rollbackSetting != nullptr ? (unsigned int)std::atoi(rollbackSetting) : 8));
+				Console::Print("Sharing the keypad with " + setting.substr(first + 1) + ".");
+			}
+		}
+
+		//Break in before the first instruction so breakpoints can be set up front.
+		if(std::getenv("EMU8_DEBUG") != nullptr)
+		{
+			debugger.pause("Paused at startup");
+		}
+
+		loadDone = std::chrono::steady_clock::now();
+		return true;
 	}
 
 	void Chip8::start()
 	{
+		ReportStartupTime();
+
+		if(useTerminal)
+		{
+			//Opened only now so everything printed while loading stays on the normal screen.
+			std::signal(SIGINT, RequestStop);
+			std::signal(SIGTERM, RequestStop);
+			terminal.open(stdout, terminalMode, terminalRefreshRate);
+			time = Time(FRAMES_PER_SECOND);
+
+			//Anything printed while the picture is up would land in the middle of it, so the console stays quiet
+			//until the terminal is closed. The debugger prompt suspends the picture to talk.
+			Console::SetEnabled(false);
+
+			while(isRunning && !stopRequested)
+			{
+				while(time.canUpdate() && isRunning)
+				{
+					unsigned long long allocationsBefore = AllocationCounter::GetCount();
+					RunFrame();
+					terminal.present(machine->getState().framebuffer);
+					CheckFrameAllocations(allocationsBefore);
+				}
+				SDL_Delay(time.ticksTillUpdate());
+			}
+
+			terminal.close();
+			Console::SetEnabled(true);
+			unsigned long long refreshes = std::max(terminal.getRefreshes(), 1ull);
+			Console::Print("Refreshed the terminal " + std::to_string(terminal.getRefreshes()) + " times, " + std::to_string(terminal.getBytesWritten() / refreshes) + " bytes each on average.");
+			return;
+		}
+
+		if(headless)
+		{
+			unsigned long long frames = 0;
+			while(isRunning && (headlessFrames == 0 || frames < headlessFrames))
+			{
+				unsigned long long allocationsBefore = AllocationCounter::GetCount();
+				RunFrame();
+				CheckFrameAllocations(allocationsBefore);
+				frames++;
+			}
+			Console::Print("Ran " + std::to_string(frames) + " frames headless.");
+			return;
+		}
+
 		while(isRunning)
 		{
 			while(time.canUpdate())
@@ -108,406 +302,196 @@ namespace Emu8
 						isRunning = false;
 					}
 
-					if(inputEvent.type == SDL_KEYDOWN)
+					if(inputEvent.type == SDL_KEYDOWN && inputEvent.key.keysym.sym == SDLK_F10)
 					{
-						if(stopProcessing)
-						{
-							vReg[regX] = ConvertToHexKeyboard(inputEvent.key.keysym.sym);
-							stopProcessing = false;
-						}
+						debugger.pause("Paused");
 					}
-
-					ProcessKeyInput();
-				}
-
-				//Logic
-				if(!stopProcessing)
-				{
-					runInstruction(mainMem[programCounter], mainMem[programCounter + 1]);
-
-					if(delayRegister > 0)
-					{
-						delayRegister--;
-					}
-					if(soundRegister > 0)
+					else if((inputEvent.type == SDL_KEYDOWN || inputEvent.type == SDL_KEYUP) && inputEvent.key.repeat == 0)
 					{
-						soundRegister--;
-						Console::Print("Beep!");
+						ProcessKeyEvent(inputEvent.key);
 					}
 				}
 
+				unsigned long long allocationsBefore = AllocationCounter::GetCount();
+				RunFrame();
+				inputLatency.keysRead(machine->takeKeysPolled(), SDL_GetTicks());
+
 				//Render
 				WriteDisplayArrayToSurface();
 				SDL_BlitScaled(screenSurface, nullptr, Display::GetWindowSurface(), nullptr);
-				SDL_Color fpsColor = {255, 0, 255, 255};
-				std::string fpsText = "FPS: " + std::to_string(time.getFPS());
-				SDL_Surface* fpsSurface = TTF_RenderText_Solid(fpsFont, fpsText.c_str(), fpsColor);
-				SDL_BlitSurface(fpsSurface, nullptr, Display::GetWindowSurface(), nullptr);
-				SDL_FreeSurface(fpsSurface);
+				int length = std::snprintf(overlayText.data(), overlayText.size(), "FPS: %d Skipped: %llu", time.getFPS(), machine->getStats().instructionsSkipped);
+				if(usePhosphor && length > 0 && (unsigned int)length < overlayText.size())
+				{
+					length += std::snprintf(overlayText.data() + length, overlayText.size() - length, " Phosphor: %dus %u rows", (int)phosphor.getLastCost(), phosphor.getRowsBlended());
+				}
+				if(rollback != nullptr && length > 0 && (unsigned int)length < overlayText.size())
+				{
+					const RollbackStats& stats = rollback->getStats();
+					double seconds = stats.frames / (double)FRAMES_PER_SECOND;
+					length += std::snprintf(overlayText.data() + length, overlayText.size() - length, " Rollbacks: %.1f/s %dus", seconds > 0 ? stats.rollbacks / seconds : 0.0, (int)stats.lastResimulationTime);
+				}
+				if(inputLatency.getSampleCount(LatencyStage::EventToRead) > 0 && length > 0 && (unsigned int)length < overlayText.size())
+				{
+					//Percentiles of the last few hundred key events, from the event to the program reading the key
+					//and from there to the frame showing the result.
+					std::snprintf(overlayText.data() + length, overlayText.size() - length, " Input p50/p95: read %d/%dms shown %d/%dms", (int)inputLatency.getPercentile(LatencyStage::EventToRead, 50), (int)inputLatency.getPercentile(LatencyStage::EventToRead, 95), (int)inputLatency.getPercentile(LatencyStage::ReadToShown, 50), (int)inputLatency.getPercentile(LatencyStage::ReadToShown, 95));
+				}
+				DrawOverlay(overlayText.data());
+				CheckFrameAllocations(allocationsBefore);
 				Display::Flip();
+				inputLatency.frameShown(SDL_GetTicks());
 			}
 			SDL_Delay(time.ticksTillUpdate());
 		}
 	}
 
-	void Chip8::loadFontData()
+	void Chip8::RunFrame()
 	{
-		std::array<unsigned char, 80> fontData =
-				{
-						0xF0, 0x90, 0x90, 0x90, 0xF0, //0
-						0x20, 0x60, 0x20, 0x20, 0x70, //1
-						0xF0, 0x10, 0xF0, 0x80, 0xF0, //2
-						0xF0, 0x10, 0xF0, 0x10, 0xF0, //3
-						0x90, 0x90, 0xF0, 0x10, 0x10, //4
-						0xF0, 0x80, 0xF0, 0x10, 0xF0, //5
-						0xF0, 0x80, 0xF0, 0x90, 0xF0, //6
-						0xF0, 0x10, 0x20, 0x40, 0x40, //7
-						0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
-						0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
-						0xF0, 0x90, 0xF0, 0x90, 0x90, //A
-						0xE0, 0x90, 0xE0, 0x90, 0xE0, //B
-						0xF0, 0x80, 0x80, 0x80, 0xF0, //C
-						0xE0, 0x90, 0x90, 0x90, 0xE0, //D
-						0xF0, 0x80, 0xF0, 0x80, 0xF0, //E
-						0xF0, 0x80, 0xF0, 0x80, 0x80 //F
-				};
+		//A netplay frame may not run at all while the other side catches up.
+		if(rollback != nullptr)
+		{
+			if(!rollback->advance(keypadState))
+			{
+				return;
+			}
+		}
+		else
+		{
+			machine->runFrame();
+		}
+
+		if(recorder.isOpen())
+		{
+			recorder.addFrame(machine->getState().framebuffer);
+		}
 
-		std::copy(std::begin(fontData), std::end(fontData), std::begin(mainMem));
+		if(sharedExport.isOpen())
+		{
+			sharedExport.publish(*machine);
+		}
+
+		if(debugger.isPaused())
+		{
+			RunDebuggerPrompt();
+		}
 
-		/*for(unsigned int i = 0; i < fontData.size(); i++)
+		if(machine->isHalted())
 		{
-			mainMem[i] = fontData[i];
-		}//*/
+			isRunning = false;
+		}
 	}
 
-	void Chip8::runInstruction(unsigned char upper, unsigned char lower)
+	void Chip8::ReportStartupTime()
 	{
-		unsigned short fullInstruction = (upper << 8) | lower; //Full two byte instruction pulled from memory.
-		unsigned char header = (unsigned char)(upper & 0xF0) >> 4; //The upper 4 bits of the instruction.
-		unsigned short address = (unsigned short)(fullInstruction & 0x0FFF); //The lowest 12 bits of the instruction.
-		unsigned char nibble = (unsigned char)(lower & 0x0F); //The lowest 4 bits of the instruction.
-		unsigned char xReg = (unsigned char)(upper & 0x0F); //The lower 4 bits of the high byte of the instruction.
-		unsigned char yReg = (unsigned char)(lower & 0xF0) >> 4; //The upper 4 bits of the low byte of the instruction.
-		unsigned char kk = lower; //The lowest 8 bits of the instruction.
+		//Called right before the first instruction runs.
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		auto milliseconds = [](std::chrono::steady_clock::duration duration) { return std::to_string(std::chrono::duration<double, std::milli>(duration).count()) + "ms"; };
+
+		Console::Print("Time to first instruction: " + milliseconds(now - PROCESS_START) + " (init " + milliseconds(initDone - PROCESS_START) + ", loading " + milliseconds(loadDone - initDone) + ").");
+	}
 
-		switch(header)
+	void Chip8::CheckFrameAllocations(unsigned long long allocationsBefore)
+	{
+		//Once warmed up a frame must not touch the heap. The debugger prompt is allowed to, so frames it ran in
+		//don't count, and only the first offender is reported so the console stays readable.
+		framesRun++;
+		if(!AllocationCounter::IsEnabled() || allocationReported || framesRun <= FRAMES_PER_SECOND || debugger.isActive())
 		{
-			case 0x00:
-			{
-				switch(fullInstruction)
-				{
-					case 0x00E0: //Clear the display
-					{
-						displayArray.fill(0);
-						programCounter += 2;
-						break;
-					}
-					case 0x00EE: //Return from subroutine
-					{
-						programCounter = stackMem.top();
-						stackMem.pop();
-						break;
-					}
-					default: //Jump to system address (ignored)
-					{
-						//Do nothing, this instruction is ignored.
-						programCounter += 2;
-						break;
-					}
-				}
-				break;
-			}
-			case 0x01: //Jump to address
-			{
-				programCounter = address;
-				break;
-			}
-			case 0x02: //Call subroutine at address
-			{
-				programCounter += 2;
-				stackMem.push(programCounter);
-				programCounter = address;
-				break;
-			}
-			case 0x03: //Skip the next instruction if Vx == kk
-			{
-				if(vReg[xReg] == kk)
-				{
-					programCounter += 2;
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x04: //Skip the next instruction if Vx != kk
-			{
-				if(vReg[xReg] != kk)
-				{
-					programCounter += 2;
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x05: //Skip the next instruction if Vx != Vy
-			{
-				if(vReg[xReg] == vReg[yReg])
-				{
-					programCounter += 2;
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x06: //Set Vx = kk
-			{
-				vReg[xReg] = kk;
-				programCounter += 2;
-				break;
-			}
-			case 0x07: // Set Vx = Vx + kk
-			{
-				vReg[xReg] = kk + vReg[xReg];
-				programCounter += 2;
-				break;
-			}
-			case 0x08:
-			{
-				switch(nibble)
-				{
-					case 0x00: //Set Vx = Vy
-					{
-						vReg[xReg] = vReg[yReg];
-						break;
-					}
-					case 0x01: //Set Vx = Vx OR Vy
-					{
-						vReg[xReg] = vReg[xReg] | vReg[yReg];
-						break;
-					}
-					case 0x02: //Set Vx = Vx AND Vy
-					{
-						vReg[xReg] = vReg[xReg] & vReg[yReg];
-						break;
-					}
-					case 0x03: //Set Vx = Vx XOR Vy
-					{
-						vReg[xReg] = vReg[xReg] ^ vReg[yReg];
-						break;
-					}
-					case 0x04: //Set Vx = Vx + Vy, set VF = carry
-					{
-						vReg[15] = vReg[xReg] > (255 - vReg[yReg]) ? (unsigned char)1 : (unsigned char)0;
-						vReg[xReg] = vReg[xReg] + vReg[yReg];
-						break;
-					}
-					case 0x05: //Set Vx = Vx - Vy, set VF = NOT borrow
-					{
-						vReg[15] = vReg[xReg] > vReg[yReg] ? (unsigned char)1 : (unsigned char)0;
-						vReg[xReg] = vReg[xReg] - vReg[yReg];
-						break;
-					}
-					case 0x06: //Set Vx = Vx SHR 1
-					{
-						vReg[15] = vReg[xReg] & 0x1 ? (unsigned char)1 : (unsigned char)0;
-						vReg[xReg] = vReg[xReg] / (unsigned char)2;
-						break;
-					}
-					case 0x07: //Set Vx = Vy - Vx, set VF = NOT borrow
-					{
-						vReg[15] = vReg[yReg] > vReg[xReg] ? (unsigned char)1 : (unsigned char)0;
-						vReg[xReg] = vReg[yReg] - vReg[xReg];
-						break;
-					}
-					case 0x0E: //Set Vx = Vx SHL 1
-					{
-						vReg[15] = vReg[xReg] & 0x8 ? (unsigned char)1 : (unsigned char)0;
-						vReg[xReg] = vReg[xReg] * (unsigned char)2;
-						break;
-					}
-					default:
-					{
-						Console::Print("Unknown instruction has been read with a header of 8!");
-						break;
-					}
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x09: //Skip next instruction if Vx != Vy
-			{
-				if(vReg[xReg] != vReg[yReg])
-				{
-					programCounter += 2;
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x0A: //Set I = nnn
-			{
-				iRegister = address;
-				programCounter += 2;
-				break;
-			}
-			case 0x0B: //Jump to location nnn + V0
-			{
-				programCounter = address + vReg[0];
-				break;
-			}
-			case 0x0C: //Set Vx = random byte AND kk
-			{
-				std::minstd_rand rand;
-				unsigned char randomNumber = (unsigned char)(rand() % (255 - 0 + 1) + 0);
-				vReg[xReg] = randomNumber & kk;
-				programCounter += 2;
-				break;
-			}
-			case 0x0D: //Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
-			{
-				//Set the flag register to zero, for if there is a collision it will be set to one.
-				vReg[15] = 0;
+			return;
+		}
 
-				for(unsigned int iY = 0, memLocation = iRegister; iY < nibble; iY++, memLocation++)
-				{
-					unsigned char dataByte = mainMem[memLocation];
-					std::array<unsigned char, 8> drawBits = std::array<unsigned char, 8>();
+		unsigned long long allocations = AllocationCounter::GetCount() - allocationsBefore;
+		if(allocations > 0)
+		{
+			Console::Print("Frame " + std::to_string(framesRun) + " made " + std::to_string(allocations) + " heap allocations, the frame loop should make none.");
+			allocationReported = true;
+		}
+	}
 
-					for(unsigned int iX = 0; iX < 8; iX++)
-					{
-						int drawX = vReg[xReg] + iX;
-						int drawY = vReg[yReg] + iY;
-
-						if(iX < 0)
-						{
-							drawX += SCREEN_WIDTH;
-						}
-						else if(iX >= SCREEN_WIDTH)
-						{
-							drawX -= SCREEN_WIDTH;
-						}
-						if(iY < 0)
-						{
-							drawY += SCREEN_HEIGHT;
-						}
-						else if(iY >= SCREEN_HEIGHT)
-						{
-							drawY -= SCREEN_HEIGHT;
-						}
-
-						unsigned char pixel = (dataByte & ((unsigned char)0x80 >> iX)) >> (7 - iX);
-						unsigned char currentDisplayBit = displayArray[(drawY * SCREEN_WIDTH) + drawX];
-
-						displayArray[(drawY * SCREEN_WIDTH) + drawX] = currentDisplayBit ^ pixel;
-
-						if(currentDisplayBit == 1 && displayArray[(drawY * SCREEN_WIDTH) + drawX] == 0)
-						{
-							vReg[15] = 1;
-						}
-					}
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x0E:
-			{
-				switch(kk)
-				{
-					case 0x9E: //Skip next instruction if key with the value of Vx is pressed
-					{
-						if(GetKeyInput(vReg[xReg]))
-						{
-							programCounter += 2;
-						}
-						break;
-					}
-					case 0xA1: //Skip next instruction if key with the value of Vx is not pressed
-					{
-						if(!GetKeyInput(vReg[xReg]))
-						{
-							programCounter += 2;
-						}
-						break;
-					}
-					default:
-					{
-						Console::Print("Unknown instruction has been read with a header of E!");
-						break;
-					}
-				}
-				programCounter += 2;
-				break;
-			}
-			case 0x0F:
+	void Chip8::DrawOverlay(const char* text)
+	{
+		SDL_Surface* windowSurface = Display::GetWindowSurface();
+
+#ifdef EMU8_SDL_TTF
+		//SDL_ttf hands back a new surface for every render, so one is only made when the text changes.
+		if(fpsFont != nullptr)
+		{
+			if(fpsSurface == nullptr || std::strncmp(text, fpsSurfaceText.data(), fpsSurfaceText.size()) != 0)
 			{
-				switch(kk)
-				{
-					case 0x07: //Set Vx = delay timer value
-					{
-						vReg[xReg] = delayRegister;
-						break;
-					}
-					case 0x0A: //Wait for a key press, store the value of the key in Vx
-					{
-						stopProcessing = true;
-						regX = xReg;
-						break;
-					}
-					case 0x15: //Set delay timer = Vx
-					{
-						delayRegister = vReg[xReg];
-						break;
-					}
-					case 0x18: //Set sound timer = Vx
-					{
-						soundRegister = vReg[xReg];
-						break;
-					}
-					case 0x1E: //Set I = I + Vx
-					{
-						iRegister = iRegister + vReg[xReg];
-						break;
-					}
-					case 0x29: //Set I = location of sprite for digit Vx
-					{
-						iRegister = vReg[xReg] * (unsigned short)5;
-						break;
-					}
-					case 0x33: //Store BCD representation of Vx in memory locations I, I+1, and I+2
-					{
-						mainMem[iRegister] = (unsigned char)(vReg[xReg] / 100);
-						mainMem[iRegister + 1] = (unsigned char)((vReg[xReg] / 10) % 10);
-						mainMem[iRegister + 2] = (unsigned char)((vReg[xReg] % 100) % 10);
-						break;
-					}
-					case 0x55: //Store registers V0 through Vx in memory starting at location I
-					{
-						for(unsigned char i = 0; i <= xReg; i++)
-						{
-							mainMem[iRegister + i] = vReg[i];
-						}
-						break;
-					}
-					case 0x65: //Read registers V0 through Vx from memory starting at location I
-					{
-						for(unsigned char i = 0; i <= xReg; i++)
-						{
-							vReg[i] = mainMem[iRegister + i];
-						}
-						break;
-					}
-					default:
-					{
-						Console::Print("Unknown instruction has been read with a header of F!");
-						break;
-					}
-				}
-				programCounter += 2;
-				break;
+				SDL_Color fpsColor = {255, 0, 255, 255};
+				SDL_FreeSurface(fpsSurface);
+				fpsSurface = TTF_RenderText_Solid(fpsFont, text, fpsColor);
+				std::strncpy(fpsSurfaceText.data(), text, fpsSurfaceText.size() - 1);
 			}
-			default:
+			SDL_BlitSurface(fpsSurface, nullptr, windowSurface, nullptr);
+			return;
+		}
+#endif
+
+		if(windowSurface->format->BytesPerPixel != 4)
+		{
+			return;
+		}
+
+		if(SDL_MUSTLOCK(windowSurface))
+		{
+			SDL_LockSurface(windowSurface);
+		}
+
+		HudFont::Draw((Uint32*)windowSurface->pixels, windowSurface->pitch / 4, windowSurface->w, windowSurface->h, OVERLAY_SCALE, OVERLAY_SCALE, text, SDL_MapRGB(windowSurface->format, 255, 0, 255), OVERLAY_SCALE);
+
+		if(SDL_MUSTLOCK(windowSurface))
+		{
+			SDL_UnlockSurface(windowSurface);
+		}
+	}
+
+	void Chip8::RunDebuggerPrompt()
+	{
+		//The window stops updating while the prompt waits on the console, a command that resumes the machine
+		//hands control back to the frame loop.
+		if(!headless)
+		{
+			WriteDisplayArrayToSurface();
+			SDL_BlitScaled(screenSurface, nullptr, Display::GetWindowSurface(), nullptr);
+			Display::Flip();
+		}
+
+		if(useTerminal)
+		{
+			terminal.suspend();
+			Console::SetEnabled(true);
+		}
+
+		Console::Print(debugger.getPauseReason() + ".");
+		Console::Print(debugger.getLocation(machine->getState()));
+
+		std::string command;
+		while(debugger.isPaused() && std::getline(std::cin, command))
+		{
+			std::string output = debugger.execute(command, machine->getState());
+			if(!output.empty())
 			{
-				Console::Print("Unknown instruction has been read, IGNORE ME!!!");
-				programCounter += 2;
-				break;
+				Console::Print(output);
 			}
 		}
+
+		//Without a console to read from there is no way to carry on debugging, so let the program run.
+		if(debugger.isPaused())
+		{
+			debugger.execute("c", machine->getState());
+		}
+
+		//Don't try to catch up on the frames that went by while paused.
+		if(!headless || useTerminal)
+		{
+			time = Time(FRAMES_PER_SECOND);
+		}
+
+		if(useTerminal)
+		{
+			Console::SetEnabled(false);
+		}
 	}
 
 	void Chip8::setPixel(SDL_Surface* surface, unsigned int x, unsigned int y, Uint32 color)
@@ -582,13 +566,43 @@ namespace Emu8
 			SDL_LockSurface(screenSurface);
 		}
 
-		//screenSurface->pixels
+		//The compositor keeps its own copy of the screen, only the rows it blended need copying over.
+		if(usePhosphor)
+		{
+			phosphor.compose(machine->getState().framebuffer);
+			for(unsigned int y = 0; y < SCREEN_HEIGHT; y++)
+			{
+				if(phosphor.isRowDirty(y))
+				{
+					std::memcpy((Uint8*)screenSurface->pixels + y * screenSurface->pitch, phosphor.getRow(y), SCREEN_WIDTH * sizeof(Uint32));
+				}
+			}
+
+			if(SDL_MUSTLOCK(screenSurface))
+			{
+				SDL_UnlockSurface(screenSurface);
+			}
+			return;
+		}
+
+		//Plane 0 alone draws white, plane 1 alone grey and both together red.
+		std::array<Uint32, 4> palette =
+				{
+						SDL_MapRGB(screenSurface->format, 0, 0, 0),
+						SDL_MapRGB(screenSurface->format, 255, 255, 255),
+						SDL_MapRGB(screenSurface->format, 170, 170, 170),
+						SDL_MapRGB(screenSurface->format, 255, 0, 0)
+				};
+
+		//The surface is always 128x64, so low resolution pixels are drawn as 2x2 blocks.
+		const Framebuffer& framebuffer = machine->getState().framebuffer;
+		unsigned int scale = SCREEN_WIDTH / framebuffer.getWidth();
 
 		for(unsigned int y = 0; y < SCREEN_HEIGHT; y++)
 		{
 			for(unsigned int x = 0; x < SCREEN_WIDTH; x++)
 			{
-				setPixel(screenSurface, x, y, displayArray[(y * SCREEN_WIDTH) + x] == 1 ? SDL_MapRGB(screenSurface->format, 255, 255, 255) : SDL_MapRGB(screenSurface->format, 0, 0, 0));
+				setPixel(screenSurface, x, y, palette[framebuffer.getPixel(x / scale, y / scale)]);
 			}
 		}
 
@@ -598,119 +612,200 @@ namespace Emu8
 		}
 	}
 
-	void Chip8::ProcessKeyInput()
+	void Chip8::LoadKeymap(std::array<signed char, SDL_NUM_SCANCODES>& keymap)
 	{
-		const Uint8* currentKeyStates = SDL_GetKeyboardState(nullptr);
-
-		keyInputs[0] = currentKeyStates[SDL_SCANCODE_1];
-		keyInputs[1] = currentKeyStates[SDL_SCANCODE_2];
-		keyInputs[2] = currentKeyStates[SDL_SCANCODE_3];
-		keyInputs[3] = currentKeyStates[SDL_SCANCODE_4];
-		keyInputs[4] = currentKeyStates[SDL_SCANCODE_Q];
-		keyInputs[5] = currentKeyStates[SDL_SCANCODE_W];
-		keyInputs[6] = currentKeyStates[SDL_SCANCODE_E];
-		keyInputs[7] = currentKeyStates[SDL_SCANCODE_R];
-		keyInputs[8] = currentKeyStates[SDL_SCANCODE_A];
-		keyInputs[9] = currentKeyStates[SDL_SCANCODE_S];
-		keyInputs[10] = currentKeyStates[SDL_SCANCODE_D];
-		keyInputs[11] = currentKeyStates[SDL_SCANCODE_F];
-		keyInputs[12] = currentKeyStates[SDL_SCANCODE_Z];
-		keyInputs[13] = currentKeyStates[SDL_SCANCODE_X];
-		keyInputs[14] = currentKeyStates[SDL_SCANCODE_C];
-		keyInputs[15] = currentKeyStates[SDL_SCANCODE_V];
+		//The COSMAC VIP keypad laid over the left of a QWERTY keyboard, listed in hex key order. EMU8_KEYMAP swaps in
+		//16 comma separated SDL key names in the same order.
+		std::array<SDL_Scancode, 16> scancodes =
+				{
+						SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+						SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+						SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+						SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+				};
+
+		const char* keymapSetting = std::getenv("EMU8_KEYMAP");
+		if(keymapSetting != nullptr)
+		{
+			std::array<SDL_Scancode, 16> custom;
+			std::string names = keymapSetting;
+			std::string::size_type start = 0;
+			unsigned int count = 0;
+			bool valid = true;
+			while(valid)
+			{
+				std::string::size_type end = names.find(',', start);
+				SDL_Scancode scancode = SDL_GetScancodeFromName(names.substr(start, end == std::string::npos ? end : end - start).c_str());
+				valid = scancode != SDL_SCANCODE_UNKNOWN && count < custom.size();
+				if(valid)
+				{
+					custom[count++] = scancode;
+				}
+				if(end == std::string::npos)
+				{
+					break;
+				}
+				start = end + 1;
+			}
+
+			if(valid && count == custom.size())
+			{
+				scancodes = custom;
+			}
+			else
+			{
+				Console::Print("EMU8_KEYMAP needs 16 comma separated SDL key names, keeping the default keys.");
+			}
+		}
+
+		keymap.fill(-1);
+		for(unsigned int key = 0; key < scancodes.size(); key++)
+		{
+			keymap[scancodes[key]] = (signed char)key;
+		}
 	}
 
-	bool Chip8::GetKeyInput(unsigned char value)
+	void Chip8::ProcessKeyEvent(const SDL_KeyboardEvent& event)
 	{
-		switch(value)
-		{
-			case 0x1:
-				return keyInputs[0];
-			case 0x2:
-				return keyInputs[1];
-			case 0x3:
-				return keyInputs[2];
-			case 0xC:
-				return keyInputs[3];
-			case 0x4:
-				return keyInputs[4];
-			case 0x5:
-				return keyInputs[5];
-			case 0x6:
-				return keyInputs[6];
-			case 0xD:
-				return keyInputs[7];
-			case 0x7:
-				return keyInputs[8];
-			case 0x8:
-				return keyInputs[9];
-			case 0x9:
-				return keyInputs[10];
-			case 0xE:
-				return keyInputs[11];
-			case 0xA:
-				return keyInputs[12];
-			case 0x0:
-				return keyInputs[13];
-			case 0xB:
-				return keyInputs[14];
-			case 0xF:
-				return keyInputs[15];
-			default:
-				return false;
+		if(event.keysym.scancode < 0 || event.keysym.scancode >= SDL_NUM_SCANCODES || keymap[event.keysym.scancode] < 0)
+		{
+			return;
+		}
+
+		unsigned char key = (unsigned char)keymap[event.keysym.scancode];
+		uint16_t bit = (uint16_t)(1 << key);
+		keypadState = event.type == SDL_KEYDOWN ? keypadState | bit : keypadState & ~bit;
+		inputLatency.keyEvent(key, event.timestamp);
+
+		//With netplay the keys only reach the machine through Rollback, on the next frame it runs.
+		if(rollback != nullptr)
+		{
+			return;
+		}
+
+		machine->setKeys(keypadState);
+
+		//Fx0A takes the key the moment it goes down, which is as soon as a program can notice it.
+		if(event.type == SDL_KEYDOWN && machine->isWaitingForKey())
+		{
+			machine->provideKey(key);
+			inputLatency.keysRead(bit, SDL_GetTicks());
 		}
 	}
 
-	unsigned char Chip8::ConvertToHexKeyboard(SDL_Keycode code)
+	void Chip8::LoadAnalysisCache()
 	{
-		switch(code)
-		{
-			case SDLK_1:
-				return 0x1;
-			case SDLK_2:
-				return 0x2;
-			case SDLK_3:
-				return 0x3;
-			case SDLK_4:
-				return 0xC;
-			case SDLK_q:
-				return 0x4;
-			case SDLK_w:
-				return 0x5;
-			case SDLK_e:
-				return 0x6;
-			case SDLK_r:
-				return 0xD;
-			case SDLK_a:
-				return 0x7;
-			case SDLK_s:
-				return 0x8;
-			case SDLK_d:
-				return 0x9;
-			case SDLK_f:
-				return 0xE;
-			case SDLK_z:
-				return 0xA;
-			case SDLK_x:
-				return 0x0;
-			case SDLK_c:
-				return 0xB;
-			case SDLK_v:
-				return 0xF;
-			default:
-				return 0;
+		//The cache directory may also hold the translated module of the ROM, next to its analysis, so a warm start
+		//runs translated code from the first frame without EMU8_AOT_DIR.
+		unsigned long long romHash = machine->getRomHash();
+		if(std::getenv("EMU8_AOT_DIR") == nullptr && machine->loadAotModule(cacheDirectory + "/" + AotModule::GetFileName(romHash)))
+		{
+			Console::Print("Running cached translated code.");
+		}
+
+		//The machine starts out knowing the cached idle loops, so it skips them from the first frame on.
+		AnalysisCache cache;
+		if(cache.open(cacheDirectory + "/" + AnalysisCache::GetFileName(romHash, machine->getProfile()), romHash, machine->getRomSize(), machine->getProfile()))
+		{
+			machine->setIdleLoops(cache.getIdleLoops(), cache.getIdleLoopCount());
+			cachedIdleLoops.assign(cache.getIdleLoops(), cache.getIdleLoops() + cache.getIdleLoopCount());
+			Console::Print("Loaded the cached analysis, " + std::to_string(cachedIdleLoops.size()) + " idle loops.");
+		}
+		else
+		{
+			//A miss, or an entry for an older version, is written out when the emulator shuts down.
+			analysisStale = true;
 		}
+
+		//Kept as loaded, the program may write over itself before it is analysed.
+		const unsigned char* rom = machine->getState().mainMem.data() + Machine::PROGRAM_START;
+		cachedRom.assign(rom, rom + machine->getRomSize());
+	}
+
+	void Chip8::SaveAnalysisCache()
+	{
+		if(cachedRom.empty() || machine == nullptr)
+		{
+			return;
+		}
+
+		//The machine only knows the loops it found since its last rollback, so they are added to the cached ones.
+		bool foundNew = false;
+		for(unsigned int i = 0; i < machine->getIdleLoopCount(); i++)
+		{
+			if(std::find(cachedIdleLoops.begin(), cachedIdleLoops.end(), machine->getIdleLoop(i)) == cachedIdleLoops.end())
+			{
+				cachedIdleLoops.push_back(machine->getIdleLoop(i));
+				foundNew = true;
+			}
+		}
+
+		if(!analysisStale && !foundNew)
+		{
+			return;
+		}
+
+		//The control flow is only worked out here, off the startup path, once per ROM and whenever new idle loops
+		//were found.
+		std::vector<unsigned char> memory(65536);
+		std::copy(cachedRom.begin(), cachedRom.end(), memory.begin() + Machine::PROGRAM_START);
+		ControlFlow analysis(machine->getProfile());
+		analysis.analyze(memory.data(), Machine::PROGRAM_START, Machine::PROGRAM_START + (unsigned int)cachedRom.size());
+
+		std::string filePath = cacheDirectory + "/" + AnalysisCache::GetFileName(machine->getRomHash(), machine->getProfile());
+		if(AnalysisCache::Write(filePath, machine->getRomHash(), machine->getRomSize(), analysis, cachedIdleLoops))
+		{
+			Console::Print("Cached the analysis in " + filePath + ".");
+		}
+		else
+		{
+			Console::Print("Failed to write " + filePath + "!");
+		}
+		analysisStale = false;
 	}
 }
 
 int main(int argc, char* args[])
 {
+	//Emu-8 --tiled <rom>... runs every ROM at once, side by side in one window.
+	if(argc > 2 && std::string(args[1]) == "--tiled")
+	{
+		Emu8::Session session;
+		if(!session.init())
+		{
+			Emu8::Console::Print("Session failed to initialize!");
+			return 1;
+		}
+		for(int i = 2; i < argc; i++)
+		{
+			session.addGame(args[i], Emu8::Profiles::FromFileName(args[i]));
+		}
+		session.start();
+		return 0;
+	}
+
+	std::string gamePath = argc > 1 ? args[1] : "Chip-8 Game pack/Invaders";
+	Emu8::Profile profile = Emu8::Profiles::FromFileName(gamePath);
+
+	if(argc > 2 && !Emu8::Profiles::Parse(args[2], profile))
+	{
+		Emu8::Console::Print("Unknown quirk profile " + std::string(args[2]) + ", expected vip, chip48, schip or xochip.");
+		return 1;
+	}
+
 	Emu8::Chip8* chip8 = new Emu8::Chip8();
 	if(!chip8->init())
 	{
 		Emu8::Console::Print("Chip8 failed to initialize!");
+		delete chip8;
+		return 1;
+	}
+	if(!chip8->loadGame(gamePath, profile))
+	{
+		Emu8::Console::Print("Failed to load " + gamePath + "!");
+		delete chip8;
+		return 1;
 	}
-	chip8->loadGame("Chip-8 Game pack/Invaders");
 	chip8->start();
 	delete chip8;
 	return 0;
@@ -2,11 +2,25 @@
 #define EMU_8_CHIP8_H
 
 #include <array>
+#include <chrono>
 #include <SDL.h>
-#include <SDL_ttf.h>
-#include <stack>
+#include <memory>
 #include <string>
+#include <vector>
+#include "Debugger.h"
+#include "InputLatency.h"
+#include "Machine.h"
+#include "Phosphor.h"
+#include "Quirks.h"
+#include "Recorder.h"
+#include "Rollback.h"
+#include "SharedExport.h"
+#include "TerminalDisplay.h"
 #include "Time.h"
+#include "Transport.h"
+
+//SDL_ttf is optional, its header is only needed where the font is actually used.
+typedef struct _TTF_Font TTF_Font;
 
 namespace Emu8
 {
@@ -14,37 +28,59 @@ namespace Emu8
 	{
 	private:
 		bool isRunning;
-		std::array<unsigned char, 4096> mainMem;
-		std::stack<unsigned short> stackMem;
-		std::array<unsigned char, 16> vReg;
-		std::array<unsigned char, 128 * 64> displayArray;
-		std::array<bool, 16> keyInputs;
-		unsigned short iRegister;
-		unsigned char delayRegister;
-		unsigned char soundRegister;
-		unsigned short programCounter;
+		bool headless;
+		unsigned long long headlessFrames;
+		std::chrono::steady_clock::time_point initDone;
+		std::chrono::steady_clock::time_point loadDone;
+		std::unique_ptr<Machine> machine;
+		uint16_t keypadState;
+		std::array<signed char, SDL_NUM_SCANCODES> keymap; //Hex key for each scancode, or -1.
+		InputLatency inputLatency;
 		SDL_Event inputEvent;
 		SDL_Surface* screenSurface;
-		bool stopProcessing;
-		unsigned char regX;
 		Time time;
 		TTF_Font* fpsFont;
+		SDL_Surface* fpsSurface;
+		std::array<char, 128> fpsSurfaceText;
+		std::array<char, 128> overlayText;
+		unsigned long long framesRun;
+		bool allocationReported;
+		Debugger debugger;
+		Recorder recorder;
+		SharedExport sharedExport;
+		Phosphor phosphor;
+		bool usePhosphor;
+		std::string cacheDirectory;
+		std::vector<unsigned char> cachedRom; //The ROM as loaded, analysed for the cache at shutdown.
+		std::vector<unsigned short> cachedIdleLoops; //Idle loops already in the cache entry, the machine forgets them on a rollback.
+		bool analysisStale;
+		UdpTransport netplayTransport;
+		std::unique_ptr<Rollback> rollback;
+		TerminalDisplay terminal;
+		bool useTerminal;
+		TerminalMode terminalMode;
+		unsigned int terminalRefreshRate;
 
-		void loadFontData();
-		void runInstruction(unsigned char upper, unsigned char lower);
 		void setPixel(SDL_Surface* surface, unsigned int x, unsigned int y, Uint32 color);
 		Uint32 getPixel(SDL_Surface* surface, unsigned int x, unsigned int y);
+		void RunFrame();
+		void ReportStartupTime();
+		void CheckFrameAllocations(unsigned long long allocationsBefore);
+		void DrawOverlay(const char* text);
 		void WriteDisplayArrayToSurface();
-		void ProcessKeyInput();
-		bool GetKeyInput(unsigned char value);
-		unsigned char ConvertToHexKeyboard(SDL_Keycode code);
+		void RunDebuggerPrompt();
+		void ProcessKeyEvent(const SDL_KeyboardEvent& event);
+		void LoadAnalysisCache();
+		void SaveAnalysisCache();
 
 	public:
+		static void LoadKeymap(std::array<signed char, SDL_NUM_SCANCODES>& keymap);
+
 		Chip8();
 		~Chip8();
 		bool init();
 		void release();
-		void loadGame(std::string filePath);
+		bool loadGame(std::string filePath, Profile profile);
 		void start();
 	};
 }
@@ -4,8 +4,18 @@
 
 namespace Emu8
 {
+	bool Console::enabled = true;
+
 	void Console::Print(std::string text)
 	{
-		std::cout << text << std::endl;
+		if(enabled)
+		{
+			std::cout << text << std::endl;
+		}
+	}
+
+	void Console::SetEnabled(bool enabled)
+	{
+		Console::enabled = enabled;
 	}
 }
@@ -7,8 +7,12 @@ namespace Emu8
 {
 	class Console
 	{
+	private:
+		static bool enabled;
+
 	public:
 		static void Print(std::string text);
+		static void SetEnabled(bool enabled);
 	};
 }
 
@@ -0,0 +1,215 @@
+#include "ControlFlow.h"
+#include <map>
+#include <set>
+#include <vector>
+#include "AnalysisCache.h"
+
+namespace Emu8
+{
+	ControlFlow::ControlFlow(Profile profile)
+			: profile(profile), memory(nullptr), codeStart(), codeEnd(), instructions(), leaders(), blocks()
+	{
+	}
+
+	void ControlFlow::analyze(const unsigned char* memory, unsigned int codeStart, unsigned int codeEnd)
+	{
+		this->memory = memory;
+		this->codeStart = codeStart;
+		this->codeEnd = codeEnd;
+		instructions.clear();
+		leaders.clear();
+		blocks.clear();
+
+		if(!inCode(codeStart))
+		{
+			return;
+		}
+
+		//Walk every reachable instruction, remembering where control can arrive from somewhere other than the
+		//instruction before it.
+		std::vector<unsigned short> pending(1, (unsigned short)codeStart);
+		std::vector<unsigned short> successors;
+		leaders.insert((unsigned short)codeStart);
+
+		while(!pending.empty())
+		{
+			unsigned short address = pending.back();
+			pending.pop_back();
+
+			while(inCode(address) && instructions.insert(address).second)
+			{
+				bool terminator = getSuccessors(address, successors);
+
+				if(!terminator)
+				{
+					address = successors[0];
+					continue;
+				}
+
+				for(unsigned short successor : successors)
+				{
+					if(inCode(successor))
+					{
+						leaders.insert(successor);
+						pending.push_back(successor);
+					}
+				}
+				break;
+			}
+		}
+
+		//Cut the reachable instructions into blocks at each leader and after each terminator.
+		for(unsigned short leader : leaders)
+		{
+			BasicBlock block = BasicBlock();
+			block.start = leader;
+
+			unsigned int address = leader;
+			while(true)
+			{
+				block.instructionCount++;
+
+				unsigned short instruction = getInstruction(address);
+				unsigned int next = address + getInstructionLength(address);
+				bool terminator = getSuccessors(address, block.successors);
+
+				if(terminator || next >= codeEnd || leaders.count((unsigned short)next) > 0 || instructions.count((unsigned short)next) == 0 || block.instructionCount == MAX_BLOCK_LENGTH)
+				{
+					block.end = (unsigned short)next;
+					block.indirectJump = (instruction & 0xF000) == 0xB000;
+					break;
+				}
+
+				address = next;
+			}
+
+			blocks[leader] = block;
+		}
+	}
+
+	void ControlFlow::load(const unsigned char* memory, unsigned int codeStart, unsigned int codeEnd, const AnalysisCache& cache)
+	{
+		//Takes the result of an earlier analyze of the same ROM instead of walking it again.
+		this->memory = memory;
+		this->codeStart = codeStart;
+		this->codeEnd = codeEnd;
+		instructions.clear();
+		leaders.clear();
+		blocks.clear();
+
+		leaders.insert(cache.getJumpTargets(), cache.getJumpTargets() + cache.getJumpTargetCount());
+		instructions.insert(cache.getInstructions(), cache.getInstructions() + cache.getInstructionCount());
+
+		for(unsigned int i = 0; i < cache.getBlockCount(); i++)
+		{
+			const AnalysisCache::Block& cached = cache.getBlock(i);
+			BasicBlock block = BasicBlock();
+			block.start = cached.start;
+			block.end = cached.end;
+			block.instructionCount = cached.instructionCount;
+			block.successors.assign(cache.getSuccessors(cached), cache.getSuccessors(cached) + cached.successorCount);
+			block.indirectJump = cached.indirectJump != 0;
+			blocks[block.start] = block;
+		}
+	}
+
+	unsigned short ControlFlow::getInstruction(unsigned int address) const
+	{
+		return (unsigned short)((memory[address & 0xFFFF] << 8) | memory[(address + 1) & 0xFFFF]);
+	}
+
+	unsigned int ControlFlow::getInstructionLength(unsigned int address) const
+	{
+		return profile == Profile::XoChip && getInstruction(address) == 0xF000 ? 4 : 2;
+	}
+
+	bool ControlFlow::isSkip(unsigned short instruction) const
+	{
+		switch(instruction >> 12)
+		{
+			case 0x3:
+			case 0x4:
+			case 0x9:
+				return true;
+			case 0x5:
+				return (instruction & 0x000F) == 0;
+			case 0xE:
+				return (instruction & 0x00FF) == 0x9E || (instruction & 0x00FF) == 0xA1;
+			default:
+				return false;
+		}
+	}
+
+	bool ControlFlow::isTerminator(unsigned short instruction) const
+	{
+		bool superChip = profile == Profile::SuperChip || profile == Profile::XoChip;
+
+		return instruction == 0x00EE || (superChip && instruction == 0x00FD) || (instruction & 0xF000) == 0x1000 || (instruction & 0xF000) == 0x2000 || (instruction & 0xF000) == 0xB000 || (instruction & 0xF0FF) == 0xF00A || isSkip(instruction);
+	}
+
+	bool ControlFlow::getSuccessors(unsigned int address, std::vector<unsigned short>& successors) const
+	{
+		unsigned short instruction = getInstruction(address);
+		unsigned short next = (unsigned short)(address + getInstructionLength(address));
+
+		successors.clear();
+
+		if(!isTerminator(instruction))
+		{
+			successors.push_back(next);
+			return false;
+		}
+
+		if((instruction & 0xF000) == 0x1000)
+		{
+			successors.push_back((unsigned short)(instruction & 0x0FFF));
+		}
+		else if((instruction & 0xF000) == 0x2000)
+		{
+			//The call target, and the return address that a matching 00EE will come back to.
+			successors.push_back((unsigned short)(instruction & 0x0FFF));
+			successors.push_back(next);
+		}
+		else if(isSkip(instruction))
+		{
+			successors.push_back(next);
+			successors.push_back((unsigned short)(next + getInstructionLength(next)));
+		}
+		else if((instruction & 0xF0FF) == 0xF00A)
+		{
+			successors.push_back(next);
+		}
+
+		return true;
+	}
+
+	bool ControlFlow::isInstruction(unsigned short address) const
+	{
+		return instructions.count(address) > 0;
+	}
+
+	Profile ControlFlow::getProfile() const
+	{
+		return profile;
+	}
+
+	const std::map<unsigned short, BasicBlock>& ControlFlow::getBlocks() const
+	{
+		return blocks;
+	}
+
+	const std::set<unsigned short>& ControlFlow::getLeaders() const
+	{
+		return leaders;
+	}
+
+	const std::set<unsigned short>& ControlFlow::getInstructions() const
+	{
+		return instructions;
+	}
+
+	bool ControlFlow::inCode(unsigned int address) const
+	{
+		return address >= codeStart && address + 1 < codeEnd;
+	}
+}
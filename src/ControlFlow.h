@@ -0,0 +1,56 @@
+#ifndef EMU_8_CONTROLFLOW_H
+#define EMU_8_CONTROLFLOW_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include "Quirks.h"
+
+namespace Emu8
+{
+	class AnalysisCache;
+
+	struct BasicBlock
+	{
+		unsigned short start;
+		unsigned short end; //Address just past the last instruction.
+		unsigned int instructionCount;
+		std::vector<unsigned short> successors;
+		bool indirectJump; //Ends in Bnnn, so where it goes is only known at runtime.
+	};
+
+	//Recovers the basic blocks of a program by following 1nnn/2nnn/skips from its entry point. Only addresses inside
+	//the code range are followed, everything the walk cannot reach is assumed to be data.
+	class ControlFlow
+	{
+	private:
+		Profile profile;
+		const unsigned char* memory;
+		unsigned int codeStart;
+		unsigned int codeEnd;
+		std::set<unsigned short> instructions;
+		std::set<unsigned short> leaders;
+		std::map<unsigned short, BasicBlock> blocks;
+
+		bool inCode(unsigned int address) const;
+
+	public:
+		static const unsigned int MAX_BLOCK_LENGTH = 32;
+
+		ControlFlow(Profile profile);
+		void analyze(const unsigned char* memory, unsigned int codeStart, unsigned int codeEnd);
+		void load(const unsigned char* memory, unsigned int codeStart, unsigned int codeEnd, const AnalysisCache& cache);
+		unsigned short getInstruction(unsigned int address) const;
+		unsigned int getInstructionLength(unsigned int address) const;
+		bool isSkip(unsigned short instruction) const;
+		bool isTerminator(unsigned short instruction) const;
+		bool getSuccessors(unsigned int address, std::vector<unsigned short>& successors) const;
+		bool isInstruction(unsigned short address) const;
+		Profile getProfile() const;
+		const std::map<unsigned short, BasicBlock>& getBlocks() const;
+		const std::set<unsigned short>& getLeaders() const;
+		const std::set<unsigned short>& getInstructions() const;
+	};
+}
+
+#endif //EMU_8_CONTROLFLOW_H
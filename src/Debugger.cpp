@@ -0,0 +1,499 @@
+#include "Debugger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Disassembler.h"
+
+namespace Emu8
+{
+	namespace
+	{
+		bool ParseNumber(const std::string& text, unsigned int& value)
+		{
+			//value is only written on success, so a failed parse leaves a default in place.
+			char* end = nullptr;
+			unsigned long parsed = std::strtoul(text.c_str(), &end, 0);
+			if(text.empty() || *end != '\0')
+			{
+				return false;
+			}
+			value = (unsigned int)parsed;
+			return true;
+		}
+
+		bool ParseRegister(const std::string& text, unsigned char& reg)
+		{
+			if(text == "I" || text == "i")
+			{
+				reg = 16;
+				return true;
+			}
+
+			unsigned int index = 0;
+			if(text.size() == 2 && (text[0] == 'V' || text[0] == 'v') && ParseNumber("0x" + text.substr(1), index))
+			{
+				reg = (unsigned char)index;
+				return true;
+			}
+			return false;
+		}
+
+		bool ParseCompare(const std::string& text, Compare& compare)
+		{
+			const char* operators[6] = {"==", "!=", "<", "<=", ">", ">="};
+
+			for(unsigned int i = 0; i < 6; i++)
+			{
+				if(text == operators[i])
+				{
+					compare = (Compare)i;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::string ToHex(unsigned int value, unsigned int digits)
+		{
+			char text[16];
+			std::snprintf(text, sizeof(text), "0x%0*X", (int)digits, value);
+			return std::string(text);
+		}
+	}
+
+	Debugger::Debugger()
+			: breakpoints(), watchpoints(), breakpointMap(), watchedPages(), hasAnyAddressBreakpoint(false), stepMode(StepMode::None), stepDepth(0), paused(false), resuming(false), pauseReason()
+	{
+	}
+
+	bool Debugger::isActive() const
+	{
+		return paused || stepMode != StepMode::None || !breakpoints.empty() || !watchpoints.empty();
+	}
+
+	bool Debugger::isPaused() const
+	{
+		return paused;
+	}
+
+	const std::string& Debugger::getPauseReason() const
+	{
+		return pauseReason;
+	}
+
+	void Debugger::pause(std::string reason)
+	{
+		paused = true;
+		resuming = false;
+		stepMode = StepMode::None;
+		pauseReason = reason;
+	}
+
+	unsigned int Debugger::addBreakpoint(const Breakpoint& breakpoint)
+	{
+		breakpoints.push_back(breakpoint);
+		rebuildMaps();
+		return (unsigned int)breakpoints.size() - 1;
+	}
+
+	unsigned int Debugger::addWatchpoint(const Watchpoint& watchpoint)
+	{
+		watchpoints.push_back(watchpoint);
+		rebuildMaps();
+		return (unsigned int)watchpoints.size() - 1;
+	}
+
+	bool Debugger::removeBreakpoint(unsigned int index)
+	{
+		if(index >= breakpoints.size())
+		{
+			return false;
+		}
+		breakpoints.erase(breakpoints.begin() + index);
+		rebuildMaps();
+		return true;
+	}
+
+	bool Debugger::removeWatchpoint(unsigned int index)
+	{
+		if(index >= watchpoints.size())
+		{
+			return false;
+		}
+		watchpoints.erase(watchpoints.begin() + index);
+		rebuildMaps();
+		return true;
+	}
+
+	bool Debugger::beforeInstruction(const MachineState& state, const MemoryAccess& access)
+	{
+		//The instruction the machine paused on runs once without being checked again, otherwise it could never
+		//get past a breakpoint.
+		if(resuming)
+		{
+			resuming = false;
+			return false;
+		}
+
+		unsigned short programCounter = state.programCounter;
+
+		if(hasAnyAddressBreakpoint || (breakpointMap[programCounter / 64] >> (programCounter % 64)) & 1)
+		{
+			for(unsigned int i = 0; i < breakpoints.size(); i++)
+			{
+				const Breakpoint& breakpoint = breakpoints[i];
+
+				if((breakpoint.anyAddress || breakpoint.address == programCounter) && conditionHolds(breakpoint, state))
+				{
+					pause("Hit " + describeBreakpoint(i));
+					return true;
+				}
+			}
+		}
+
+		if(access.length == 0)
+		{
+			return false;
+		}
+
+		//Most accesses land on pages nobody watches, those are turned away without looking at the watchpoints.
+		unsigned int last = access.address + access.length - 1;
+		bool pageWatched = false;
+		for(unsigned int page = access.address / 256; page <= last / 256 && page < 256; page++)
+		{
+			pageWatched = pageWatched || (watchedPages[page / 64] >> (page % 64)) & 1;
+		}
+
+		if(!pageWatched)
+		{
+			return false;
+		}
+
+		for(unsigned int i = 0; i < watchpoints.size(); i++)
+		{
+			const Watchpoint& watchpoint = watchpoints[i];
+
+			if((access.write ? watchpoint.onWrite : watchpoint.onRead) && access.address <= watchpoint.end && last >= watchpoint.start)
+			{
+				pause("Hit " + describeWatchpoint(i) + ", " + (access.write ? "write to " : "read from ") + ToHex(access.address, 4) + " length " + std::to_string(access.length));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Debugger::afterInstruction(const MachineState& state)
+	{
+		//The stack pointer tells how deep in subroutines the program is, which is all stepping over or out needs.
+		bool done = false;
+
+		switch(stepMode)
+		{
+			case StepMode::Into:
+				done = true;
+				break;
+			case StepMode::Over:
+				done = state.stackPointer <= stepDepth;
+				break;
+			case StepMode::Out:
+				done = state.stackPointer < stepDepth;
+				break;
+			case StepMode::None:
+			default:
+				break;
+		}
+
+		if(done || (stepMode != StepMode::None && state.halted))
+		{
+			pause("Stepped");
+		}
+	}
+
+	std::string Debugger::getLocation(const MachineState& state) const
+	{
+		return disassemble(state, state.programCounter, 1);
+	}
+
+	std::string Debugger::execute(std::string command, const MachineState& state)
+	{
+		std::istringstream stream(command);
+		std::vector<std::string> words;
+		std::string word;
+		while(stream >> word)
+		{
+			words.push_back(word);
+		}
+
+		if(words.empty())
+		{
+			return "";
+		}
+
+		const std::string& name = words[0];
+		unsigned int first = 0;
+		unsigned int second = 0;
+
+		if(name == "c" || name == "s" || name == "n" || name == "f")
+		{
+			resume(name == "c" ? StepMode::None : name == "s" ? StepMode::Into : name == "n" ? StepMode::Over : StepMode::Out, state);
+			return "";
+		}
+		else if(name == "b" && words.size() >= 2)
+		{
+			Breakpoint breakpoint = {};
+			unsigned int conditionAt = 1;
+
+			if(words[1] != "if")
+			{
+				if(!ParseNumber(words[1], first))
+				{
+					return "Bad address " + words[1] + ".";
+				}
+				breakpoint.address = (unsigned short)first;
+				conditionAt = 2;
+			}
+			else
+			{
+				breakpoint.anyAddress = true;
+			}
+
+			if(words.size() > conditionAt)
+			{
+				if(words.size() != conditionAt + 4 || words[conditionAt] != "if" || !ParseRegister(words[conditionAt + 1], breakpoint.reg) || !ParseCompare(words[conditionAt + 2], breakpoint.compare) || !ParseNumber(words[conditionAt + 3], second))
+				{
+					return "Expected a condition like: if V3 == 0x10, if I >= 0x300";
+				}
+				breakpoint.conditional = true;
+				breakpoint.value = (unsigned short)second;
+			}
+			else if(breakpoint.anyAddress)
+			{
+				return "A breakpoint needs an address, a condition or both.";
+			}
+
+			return "Added " + describeBreakpoint(addBreakpoint(breakpoint)) + ".";
+		}
+		else if(name == "w" && words.size() >= 2)
+		{
+			Watchpoint watchpoint = {0, 0, true, true};
+			unsigned int kindAt = 2;
+
+			if(!ParseNumber(words[1], first))
+			{
+				return "Bad address " + words[1] + ".";
+			}
+			second = first;
+			if(words.size() >= 3 && ParseNumber(words[2], second))
+			{
+				kindAt = 3;
+			}
+			if(second < first || second > 0xFFFF)
+			{
+				return "Bad address range.";
+			}
+			if(words.size() > kindAt)
+			{
+				watchpoint.onRead = words[kindAt].find('r') != std::string::npos;
+				watchpoint.onWrite = words[kindAt].find('w') != std::string::npos;
+				if(!watchpoint.onRead && !watchpoint.onWrite)
+				{
+					return "Bad watchpoint kind " + words[kindAt] + ", expected r, w or rw.";
+				}
+			}
+			watchpoint.start = (unsigned short)first;
+			watchpoint.end = (unsigned short)second;
+
+			return "Added " + describeWatchpoint(addWatchpoint(watchpoint)) + ".";
+		}
+		else if((name == "d" || name == "dw") && words.size() == 2 && ParseNumber(words[1], first))
+		{
+			bool removed = name == "d" ? removeBreakpoint(first) : removeWatchpoint(first);
+			return removed ? "Deleted." : "No such " + std::string(name == "d" ? "breakpoint." : "watchpoint.");
+		}
+		else if(name == "l")
+		{
+			std::string text;
+			for(unsigned int i = 0; i < breakpoints.size(); i++)
+			{
+				text += describeBreakpoint(i) + "\n";
+			}
+			for(unsigned int i = 0; i < watchpoints.size(); i++)
+			{
+				text += describeWatchpoint(i) + "\n";
+			}
+			return text.empty() ? "Nothing is set." : text.substr(0, text.size() - 1);
+		}
+		else if(name == "x")
+		{
+			first = state.programCounter;
+			second = 8;
+			if((words.size() >= 2 && !ParseNumber(words[1], first)) || (words.size() >= 3 && !ParseNumber(words[2], second)))
+			{
+				return "Usage: x [address] [count]";
+			}
+			return disassemble(state, first, second);
+		}
+		else if(name == "r")
+		{
+			return dumpRegisters(state);
+		}
+		else if(name == "m" && words.size() >= 2 && ParseNumber(words[1], first))
+		{
+			second = 64;
+			if(words.size() >= 3 && !ParseNumber(words[2], second))
+			{
+				return "Usage: m address [length]";
+			}
+			return dumpMemory(state, first, second);
+		}
+
+		return "Commands:\n"
+				"  c                          continue\n"
+				"  s / n / f                  step into / over / out of a subroutine\n"
+				"  b addr [if reg op value]   break at addr, reg is V0-VF or I, op is == != < <= > >=\n"
+				"  b if reg op value          break anywhere the condition holds\n"
+				"  w start [end] [r|w|rw]     watch memory for reads and/or writes\n"
+				"  d n / dw n                 delete breakpoint / watchpoint n\n"
+				"  l                          list breakpoints and watchpoints\n"
+				"  x [addr] [count]           disassemble\n"
+				"  r                          show registers\n"
+				"  m addr [length]            show memory";
+	}
+
+	void Debugger::rebuildMaps()
+	{
+		breakpointMap.fill(0);
+		watchedPages.fill(0);
+		hasAnyAddressBreakpoint = false;
+
+		for(const Breakpoint& breakpoint : breakpoints)
+		{
+			if(breakpoint.anyAddress)
+			{
+				hasAnyAddressBreakpoint = true;
+				continue;
+			}
+			breakpointMap[breakpoint.address / 64] |= (uint64_t)1 << (breakpoint.address % 64);
+		}
+
+		for(const Watchpoint& watchpoint : watchpoints)
+		{
+			for(unsigned int page = watchpoint.start / 256; page <= watchpoint.end / 256u; page++)
+			{
+				watchedPages[page / 64] |= (uint64_t)1 << (page % 64);
+			}
+		}
+	}
+
+	void Debugger::resume(StepMode mode, const MachineState& state)
+	{
+		paused = false;
+		resuming = true;
+		stepMode = mode;
+		stepDepth = state.stackPointer;
+	}
+
+	bool Debugger::conditionHolds(const Breakpoint& breakpoint, const MachineState& state) const
+	{
+		if(!breakpoint.conditional)
+		{
+			return true;
+		}
+
+		unsigned short value = breakpoint.reg == 16 ? state.iRegister : state.vReg[breakpoint.reg & 0xF];
+
+		switch(breakpoint.compare)
+		{
+			case Compare::Equal:
+				return value == breakpoint.value;
+			case Compare::NotEqual:
+				return value != breakpoint.value;
+			case Compare::Less:
+				return value < breakpoint.value;
+			case Compare::LessEqual:
+				return value <= breakpoint.value;
+			case Compare::Greater:
+				return value > breakpoint.value;
+			case Compare::GreaterEqual:
+				return value >= breakpoint.value;
+			default:
+				return false;
+		}
+	}
+
+	std::string Debugger::describeBreakpoint(unsigned int index) const
+	{
+		const char* operators[6] = {"==", "!=", "<", "<=", ">", ">="};
+		const Breakpoint& breakpoint = breakpoints[index];
+		std::string text = "breakpoint " + std::to_string(index);
+
+		if(!breakpoint.anyAddress)
+		{
+			text += " at " + ToHex(breakpoint.address, 3);
+		}
+		if(breakpoint.conditional)
+		{
+			std::string reg = breakpoint.reg == 16 ? "I" : "V" + ToHex(breakpoint.reg, 1).substr(2);
+			text += " if " + reg + " " + operators[(int)breakpoint.compare] + " " + ToHex(breakpoint.value, 2);
+		}
+		return text;
+	}
+
+	std::string Debugger::describeWatchpoint(unsigned int index) const
+	{
+		const Watchpoint& watchpoint = watchpoints[index];
+		std::string kind = std::string(watchpoint.onRead ? "r" : "") + (watchpoint.onWrite ? "w" : "");
+
+		return "watchpoint " + std::to_string(index) + " on " + ToHex(watchpoint.start, 3) + "-" + ToHex(watchpoint.end, 3) + " (" + kind + ")";
+	}
+
+	std::string Debugger::disassemble(const MachineState& state, unsigned int address, unsigned int count) const
+	{
+		std::string text;
+
+		for(unsigned int i = 0; i < count && address + 1 < state.mainMem.size(); i++)
+		{
+			unsigned short instruction = (unsigned short)((state.mainMem[address] << 8) | state.mainMem[address + 1]);
+			unsigned short nextWord = address + 3 < state.mainMem.size() ? (unsigned short)((state.mainMem[address + 2] << 8) | state.mainMem[address + 3]) : (unsigned short)0;
+			std::string marker = address == state.programCounter ? "> " : "  ";
+
+			text += (i > 0 ? "\n" : "") + marker + ToHex(address, 3) + "  " + ToHex(instruction, 4) + "  " + Disassembler::Disassemble(instruction, nextWord);
+			address += instruction == 0xF000 ? 4 : 2;
+		}
+		return text;
+	}
+
+	std::string Debugger::dumpRegisters(const MachineState& state) const
+	{
+		std::string text;
+
+		for(unsigned int i = 0; i < state.vReg.size(); i++)
+		{
+			text += "V" + ToHex(i, 1).substr(2) + "=" + ToHex(state.vReg[i], 2) + (i % 8 == 7 ? "\n" : " ");
+		}
+		text += "I=" + ToHex(state.iRegister, 4) + " PC=" + ToHex(state.programCounter, 4) + " SP=" + std::to_string(state.stackPointer) + " DT=" + std::to_string(state.delayRegister) + " ST=" + std::to_string(state.soundRegister);
+
+		for(unsigned int i = state.stackPointer; i > 0; i--)
+		{
+			text += (i == state.stackPointer ? "\nStack: " : " ") + ToHex(state.stackMem[i - 1], 3);
+		}
+		return text;
+	}
+
+	std::string Debugger::dumpMemory(const MachineState& state, unsigned int address, unsigned int length) const
+	{
+		std::string text;
+
+		for(unsigned int i = 0; i < length && address + i < state.mainMem.size(); i++)
+		{
+			if(i % 16 == 0)
+			{
+				text += (i > 0 ? "\n" : "") + ToHex(address + i, 4) + ":";
+			}
+			text += " " + ToHex(state.mainMem[address + i], 2).substr(2);
+		}
+		return text;
+	}
+}
@@ -0,0 +1,98 @@
+#ifndef EMU_8_DEBUGGER_H
+#define EMU_8_DEBUGGER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MachineState.h"
+
+namespace Emu8
+{
+	enum class Compare
+	{
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual
+	};
+
+	enum class StepMode
+	{
+		None,
+		Into,
+		Over, //Runs a 2nnn call as a whole
+		Out //Runs until the current subroutine returns
+	};
+
+	struct Breakpoint
+	{
+		bool anyAddress; //Only the condition decides, checked before every instruction.
+		unsigned short address;
+		bool conditional;
+		unsigned char reg; //V0 through VF, or 16 for I.
+		Compare compare;
+		unsigned short value;
+	};
+
+	struct Watchpoint
+	{
+		unsigned short start;
+		unsigned short end; //Inclusive.
+		bool onRead;
+		bool onWrite;
+	};
+
+	//The memory an instruction is about to touch, length is zero if it touches none.
+	struct MemoryAccess
+	{
+		unsigned short address;
+		unsigned int length;
+		bool write;
+	};
+
+	//Breakpoints, watchpoints and stepping for a Machine. The machine only asks the debugger once per frame whether
+	//anything is armed, and only then switches to the slower loop that consults it around every instruction.
+	class Debugger
+	{
+	private:
+		std::vector<Breakpoint> breakpoints;
+		std::vector<Watchpoint> watchpoints;
+		std::array<uint64_t, 1024> breakpointMap; //One bit per address with a breakpoint on it.
+		std::array<uint64_t, 4> watchedPages; //One bit per 256 byte page a watchpoint overlaps.
+		bool hasAnyAddressBreakpoint;
+		StepMode stepMode;
+		unsigned char stepDepth;
+		bool paused;
+		bool resuming;
+		std::string pauseReason;
+
+		void rebuildMaps();
+		void resume(StepMode mode, const MachineState& state);
+		bool conditionHolds(const Breakpoint& breakpoint, const MachineState& state) const;
+		std::string describeBreakpoint(unsigned int index) const;
+		std::string describeWatchpoint(unsigned int index) const;
+		std::string disassemble(const MachineState& state, unsigned int address, unsigned int count) const;
+		std::string dumpRegisters(const MachineState& state) const;
+		std::string dumpMemory(const MachineState& state, unsigned int address, unsigned int length) const;
+
+	public:
+		Debugger();
+		bool isActive() const;
+		bool isPaused() const;
+		const std::string& getPauseReason() const;
+		void pause(std::string reason);
+		unsigned int addBreakpoint(const Breakpoint& breakpoint);
+		unsigned int addWatchpoint(const Watchpoint& watchpoint);
+		bool removeBreakpoint(unsigned int index);
+		bool removeWatchpoint(unsigned int index);
+		bool beforeInstruction(const MachineState& state, const MemoryAccess& access);
+		void afterInstruction(const MachineState& state);
+		std::string getLocation(const MachineState& state) const;
+		std::string execute(std::string command, const MachineState& state);
+	};
+}
+
+#endif //EMU_8_DEBUGGER_H
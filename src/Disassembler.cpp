@@ -0,0 +1,184 @@
+#include "Disassembler.h"
+#include <cstdio>
+#include <string>
+
+namespace Emu8
+{
+	std::string Disassembler::Disassemble(unsigned short instruction, unsigned short nextWord)
+	{
+		unsigned int address = instruction & 0x0FFF;
+		unsigned int nibble = instruction & 0x000F;
+		unsigned int x = (instruction & 0x0F00) >> 8;
+		unsigned int y = (instruction & 0x00F0) >> 4;
+		unsigned int kk = instruction & 0x00FF;
+		char text[32];
+
+		//Anything that does not decode is shown as a data word.
+		std::snprintf(text, sizeof(text), "DW 0x%04X", instruction);
+
+		switch(instruction >> 12)
+		{
+			case 0x0:
+			{
+				switch(instruction)
+				{
+					case 0x00E0:
+						return "CLS";
+					case 0x00EE:
+						return "RET";
+					case 0x00FB:
+						return "SCR";
+					case 0x00FC:
+						return "SCL";
+					case 0x00FD:
+						return "EXIT";
+					case 0x00FE:
+						return "LOW";
+					case 0x00FF:
+						return "HIGH";
+					default:
+					{
+						if((instruction & 0xFFF0) == 0x00C0)
+						{
+							std::snprintf(text, sizeof(text), "SCD %u", nibble);
+						}
+						else if((instruction & 0xFFF0) == 0x00D0)
+						{
+							std::snprintf(text, sizeof(text), "SCU %u", nibble);
+						}
+						else
+						{
+							std::snprintf(text, sizeof(text), "SYS 0x%03X", address);
+						}
+						break;
+					}
+				}
+				break;
+			}
+			case 0x1:
+				std::snprintf(text, sizeof(text), "JP 0x%03X", address);
+				break;
+			case 0x2:
+				std::snprintf(text, sizeof(text), "CALL 0x%03X", address);
+				break;
+			case 0x3:
+				std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk);
+				break;
+			case 0x4:
+				std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk);
+				break;
+			case 0x5:
+			{
+				const char* formats[4] = {"SE V%X, V%X", nullptr, "SAVE V%X-V%X", "LOAD V%X-V%X"};
+				if(nibble < 4 && formats[nibble] != nullptr)
+				{
+					std::snprintf(text, sizeof(text), formats[nibble], x, y);
+				}
+				break;
+			}
+			case 0x6:
+				std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk);
+				break;
+			case 0x7:
+				std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk);
+				break;
+			case 0x8:
+			{
+				const char* mnemonics[16] = {"LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN", nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, "SHL", nullptr};
+				if(mnemonics[nibble] != nullptr)
+				{
+					std::snprintf(text, sizeof(text), "%s V%X, V%X", mnemonics[nibble], x, y);
+				}
+				break;
+			}
+			case 0x9:
+				std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y);
+				break;
+			case 0xA:
+				std::snprintf(text, sizeof(text), "LD I, 0x%03X", address);
+				break;
+			case 0xB:
+				std::snprintf(text, sizeof(text), "JP V0, 0x%03X", address);
+				break;
+			case 0xC:
+				std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk);
+				break;
+			case 0xD:
+				std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, nibble);
+				break;
+			case 0xE:
+			{
+				if(kk == 0x9E)
+				{
+					std::snprintf(text, sizeof(text), "SKP V%X", x);
+				}
+				else if(kk == 0xA1)
+				{
+					std::snprintf(text, sizeof(text), "SKNP V%X", x);
+				}
+				break;
+			}
+			case 0xF:
+			{
+				if(instruction == 0xF000)
+				{
+					std::snprintf(text, sizeof(text), "LD I, long 0x%04X", nextWord);
+					break;
+				}
+
+				switch(kk)
+				{
+					case 0x01:
+						std::snprintf(text, sizeof(text), "PLANE %u", x);
+						break;
+					case 0x02:
+						return "AUDIO";
+					case 0x07:
+						std::snprintf(text, sizeof(text), "LD V%X, DT", x);
+						break;
+					case 0x0A:
+						std::snprintf(text, sizeof(text), "LD V%X, K", x);
+						break;
+					case 0x15:
+						std::snprintf(text, sizeof(text), "LD DT, V%X", x);
+						break;
+					case 0x18:
+						std::snprintf(text, sizeof(text), "LD ST, V%X", x);
+						break;
+					case 0x1E:
+						std::snprintf(text, sizeof(text), "ADD I, V%X", x);
+						break;
+					case 0x29:
+						std::snprintf(text, sizeof(text), "LD F, V%X", x);
+						break;
+					case 0x30:
+						std::snprintf(text, sizeof(text), "LD HF, V%X", x);
+						break;
+					case 0x33:
+						std::snprintf(text, sizeof(text), "LD B, V%X", x);
+						break;
+					case 0x3A:
+						std::snprintf(text, sizeof(text), "PITCH V%X", x);
+						break;
+					case 0x55:
+						std::snprintf(text, sizeof(text), "LD [I], V%X", x);
+						break;
+					case 0x65:
+						std::snprintf(text, sizeof(text), "LD V%X, [I]", x);
+						break;
+					case 0x75:
+						std::snprintf(text, sizeof(text), "LD R, V%X", x);
+						break;
+					case 0x85:
+						std::snprintf(text, sizeof(text), "LD V%X, R", x);
+						break;
+					default:
+						break;
+				}
+				break;
+			}
+		}
+
+		return std::string(text);
+	}
+}
@@ -0,0 +1,16 @@
+#ifndef EMU_8_DISASSEMBLER_H
+#define EMU_8_DISASSEMBLER_H
+
+#include <string>
+
+namespace Emu8
+{
+	class Disassembler
+	{
+	public:
+		//Decodes the superset of CHIP-8, SCHIP and XO-CHIP. The second word is only used by F000 nnnn.
+		static std::string Disassemble(unsigned short instruction, unsigned short nextWord = 0);
+	};
+}
+
+#endif //EMU_8_DISASSEMBLER_H
@@ -1,5 +1,8 @@
 #include "Console.h"
 #include "Display.h"
+#include "Framebuffer.h"
+#include <algorithm>
+#include <array>
 #include <SDL.h>
 
 namespace Emu8
@@ -49,6 +52,8 @@ namespace Emu8
 
 		windowSurface = SDL_GetWindowSurface(window);
 		windowRenderer = SDL_GetRenderer(window);
+		Display::screenWidth = screenWidth;
+		Display::screenHeight = screenHeight;
 
 		return true;
 	}
@@ -66,4 +71,68 @@ namespace Emu8
 	{
 		SDL_UpdateWindowSurface(window);
 	}
+
+	SDL_Rect Display::GetTileArea(unsigned int index, unsigned int count)
+	{
+		//Lays count 2:1 tiles out in a grid, with the column count that makes them biggest in the window and a one
+		//pixel gap around each.
+		unsigned int columns = 1;
+		unsigned int tileWidth = 0;
+		for(unsigned int candidate = 1; candidate <= std::max(count, 1u); candidate++)
+		{
+			unsigned int rows = (count + candidate - 1) / candidate;
+			unsigned int width = std::min((unsigned int)screenWidth / candidate, rows > 0 ? (unsigned int)screenHeight / rows * 2 : (unsigned int)screenWidth);
+			if(width > tileWidth)
+			{
+				tileWidth = width;
+				columns = candidate;
+			}
+		}
+
+		SDL_Rect area = {(int)((index % columns) * tileWidth + 1), (int)((index / columns) * tileWidth / 2 + 1), (int)tileWidth - 2, (int)tileWidth / 2 - 2};
+		return area;
+	}
+
+	void Display::DrawFrame(SDL_Surface* surface, const uint64_t* plane0, const uint64_t* plane1, bool hiRes)
+	{
+		//Draws a frame into a 128x64 surface of 32 bit pixels. The planes are packed like Framebuffer, a low
+		//resolution frame only uses the top left quarter and is drawn doubled.
+		const std::array<Uint32, 4> palette =
+				{
+						SDL_MapRGB(surface->format, 0, 0, 0),
+						SDL_MapRGB(surface->format, 255, 255, 255),
+						SDL_MapRGB(surface->format, 170, 170, 170),
+						SDL_MapRGB(surface->format, 255, 0, 0)
+				};
+
+		if(SDL_MUSTLOCK(surface))
+		{
+			SDL_LockSurface(surface);
+		}
+
+		unsigned int scale = hiRes ? 1 : 2;
+		for(unsigned int y = 0; y < Framebuffer::MAX_HEIGHT; y++)
+		{
+			Uint32* pixels = (Uint32*)((Uint8*)surface->pixels + y * surface->pitch);
+			unsigned int row = (y / scale) * Framebuffer::WORDS_PER_ROW;
+			for(unsigned int x = 0; x < Framebuffer::MAX_WIDTH; x++)
+			{
+				unsigned int column = x / scale;
+				unsigned int shift = 63 - column % 64;
+				pixels[x] = palette[((plane0[row + column / 64] >> shift) & 1) | (((plane1[row + column / 64] >> shift) & 1) << 1)];
+			}
+		}
+
+		if(SDL_MUSTLOCK(surface))
+		{
+			SDL_UnlockSurface(surface);
+		}
+	}
+
+	void Display::DrawHaltedBar(SDL_Rect area)
+	{
+		//A machine that has stopped gets a red bar along the bottom of its tile.
+		SDL_Rect bar = {area.x, area.y + area.h - 4, area.w, 4};
+		SDL_FillRect(windowSurface, &bar, SDL_MapRGB(windowSurface->format, 255, 0, 0));
+	}
 }
@@ -1,6 +1,7 @@
 #ifndef EMU_8_DISPLAY_H
 #define EMU_8_DISPLAY_H
 
+#include <cstdint>
 #include <SDL.h>
 
 namespace Emu8
@@ -23,6 +24,9 @@ namespace Emu8
 		static bool Create(const int screenWidth, const int screenHeight);
 		static void Destroy();
 		static void Flip();
+		static SDL_Rect GetTileArea(unsigned int index, unsigned int count);
+		static void DrawFrame(SDL_Surface* surface, const uint64_t* plane0, const uint64_t* plane1, bool hiRes);
+		static void DrawHaltedBar(SDL_Rect area);
 	};
 }
 
@@ -0,0 +1,104 @@
+#include "Emu8Env.h"
+#include <string>
+#include "Console.h"
+#include "Quirks.h"
+#include "VectorEnv.h"
+
+struct Emu8Env
+{
+	Emu8::VectorEnv env;
+};
+
+Emu8Env* emu8_env_create(const unsigned char* rom, unsigned int romSize, const char* profile, unsigned int count, unsigned int threads)
+{
+	Emu8::Profile parsedProfile = Emu8::Profile::CosmacVip;
+	if(profile != nullptr && !Emu8::Profiles::Parse(profile, parsedProfile))
+	{
+		return nullptr;
+	}
+
+	//Thousands of machines printing unknown instruction warnings would swamp whoever embeds this.
+	Emu8::Console::SetEnabled(false);
+
+	Emu8Env* env = new Emu8Env();
+	if(!env->env.create(rom, romSize, parsedProfile, count, threads))
+	{
+		delete env;
+		return nullptr;
+	}
+	return env;
+}
+
+void emu8_env_destroy(Emu8Env* env)
+{
+	delete env;
+}
+
+void emu8_env_set_frame_skip(Emu8Env* env, unsigned int frameSkip)
+{
+	env->env.setFrameSkip(frameSkip);
+}
+
+void emu8_env_set_max_episode_frames(Emu8Env* env, unsigned int maxEpisodeFrames)
+{
+	env->env.setMaxEpisodeFrames(maxEpisodeFrames);
+}
+
+void emu8_env_set_cycles_per_frame(Emu8Env* env, unsigned int cyclesPerFrame)
+{
+	env->env.setCyclesPerFrame(cyclesPerFrame);
+}
+
+int emu8_env_add_memory_probe(Emu8Env* env, unsigned int address, unsigned int length, float weight)
+{
+	if(address > 0xFFFF || length == 0 || length > 4)
+	{
+		return 0;
+	}
+
+	Emu8::RewardProbe probe = {false, (unsigned short)address, (unsigned char)length, weight};
+	env->env.addProbe(probe);
+	return 1;
+}
+
+int emu8_env_add_register_probe(Emu8Env* env, unsigned int reg, float weight)
+{
+	if(reg > 0xF)
+	{
+		return 0;
+	}
+
+	Emu8::RewardProbe probe = {true, (unsigned short)reg, 1, weight};
+	env->env.addProbe(probe);
+	return 1;
+}
+
+void emu8_env_reset(Emu8Env* env, const uint32_t* seeds)
+{
+	env->env.reset(seeds);
+}
+
+void emu8_env_step(Emu8Env* env, const uint16_t* actions)
+{
+	env->env.step(actions);
+}
+
+unsigned int emu8_env_count(const Emu8Env* env)
+{
+	return env->env.getCount();
+}
+
+const uint8_t* emu8_env_observations(const Emu8Env* env)
+{
+	return env->env.getObservations();
+}
+
+const float* emu8_env_rewards(const Emu8Env* env)
+{
+	return env->env.getRewards();
+}
+
+const uint8_t* emu8_env_dones(const Emu8Env* env)
+{
+	return env->env.getDones();
+}
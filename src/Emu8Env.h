@@ -0,0 +1,46 @@
+#ifndef EMU_8_EMU8ENV_H
+#define EMU_8_EMU8ENV_H
+
+#include <stdint.h>
+
+//C interface to Emu8::VectorEnv, for language bindings and anything else that cannot link against the C++ classes.
+//The observation, reward and done buffers stay at the same address for the life of the environment and are
+//rewritten in place by every reset and step.
+
+#ifdef _WIN32
+#define EMU8_ENV_API __declspec(dllexport)
+#else
+#define EMU8_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct Emu8Env Emu8Env;
+
+//profile is vip, chip48, schip or xochip, threads of zero uses one per core. Returns null on failure.
+EMU8_ENV_API Emu8Env* emu8_env_create(const unsigned char* rom, unsigned int romSize, const char* profile, unsigned int count, unsigned int threads);
+EMU8_ENV_API void emu8_env_destroy(Emu8Env* env);
+EMU8_ENV_API void emu8_env_set_frame_skip(Emu8Env* env, unsigned int frameSkip);
+EMU8_ENV_API void emu8_env_set_max_episode_frames(Emu8Env* env, unsigned int maxEpisodeFrames);
+EMU8_ENV_API void emu8_env_set_cycles_per_frame(Emu8Env* env, unsigned int cyclesPerFrame);
+//Rewards are weight * change in value per step, summed over every probe added.
+EMU8_ENV_API int emu8_env_add_memory_probe(Emu8Env* env, unsigned int address, unsigned int length, float weight);
+EMU8_ENV_API int emu8_env_add_register_probe(Emu8Env* env, unsigned int reg, float weight);
+//seeds may be null, otherwise it holds one seed per machine.
+EMU8_ENV_API void emu8_env_reset(Emu8Env* env, const uint32_t* seeds);
+//actions holds one 16 bit mask of held keys per machine, bit n for key n.
+EMU8_ENV_API void emu8_env_step(Emu8Env* env, const uint16_t* actions);
+EMU8_ENV_API unsigned int emu8_env_count(const Emu8Env* env);
+//count * 64 * 128 bytes, each the plane bits of one pixel.
+EMU8_ENV_API const uint8_t* emu8_env_observations(const Emu8Env* env);
+EMU8_ENV_API const float* emu8_env_rewards(const Emu8Env* env);
+EMU8_ENV_API const uint8_t* emu8_env_dones(const Emu8Env* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //EMU_8_EMU8ENV_H
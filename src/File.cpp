@@ -23,8 +23,8 @@ namespace Emu8
 	}
 
 	File::File(std::string filePath)
+			: fileStream(), filePath(filePath), isOpen(false)
 	{
-		this->filePath = filePath;
 	}
 
 	File::~File()
@@ -0,0 +1,191 @@
+#include "Framebuffer.h"
+#include <cstring>
+
+namespace Emu8
+{
+	Framebuffer::Framebuffer()
+			: planes(), hiRes(false)
+	{
+	}
+
+	unsigned int Framebuffer::getWidth() const
+	{
+		return hiRes ? MAX_WIDTH : MAX_WIDTH / 2;
+	}
+
+	unsigned int Framebuffer::getHeight() const
+	{
+		return hiRes ? MAX_HEIGHT : MAX_HEIGHT / 2;
+	}
+
+	bool Framebuffer::isHiRes() const
+	{
+		return hiRes;
+	}
+
+	void Framebuffer::setHiRes(bool hiRes)
+	{
+		this->hiRes = hiRes;
+		clear(0x3);
+	}
+
+	void Framebuffer::clear(unsigned char planeMask)
+	{
+		for(unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if(planeMask & (1 << plane))
+			{
+				planes[plane].fill(0);
+			}
+		}
+	}
+
+	void Framebuffer::scrollDown(unsigned int rows, unsigned char planeMask)
+	{
+		unsigned int height = getHeight();
+		rows = rows > height ? height : rows;
+
+		for(unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if(planeMask & (1 << plane))
+			{
+				uint64_t* data = planes[plane].data();
+				std::memmove(data + rows * WORDS_PER_ROW, data, (height - rows) * WORDS_PER_ROW * sizeof(uint64_t));
+				std::memset(data, 0, rows * WORDS_PER_ROW * sizeof(uint64_t));
+			}
+		}
+	}
+
+	void Framebuffer::scrollUp(unsigned int rows, unsigned char planeMask)
+	{
+		unsigned int height = getHeight();
+		rows = rows > height ? height : rows;
+
+		for(unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if(planeMask & (1 << plane))
+			{
+				uint64_t* data = planes[plane].data();
+				std::memmove(data, data + rows * WORDS_PER_ROW, (height - rows) * WORDS_PER_ROW * sizeof(uint64_t));
+				std::memset(data + (height - rows) * WORDS_PER_ROW, 0, rows * WORDS_PER_ROW * sizeof(uint64_t));
+			}
+		}
+	}
+
+	void Framebuffer::scrollLeft(unsigned int pixels, unsigned char planeMask)
+	{
+		if(pixels == 0 || pixels >= 64)
+		{
+			return;
+		}
+
+		for(unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if(planeMask & (1 << plane))
+			{
+				for(unsigned int y = 0; y < getHeight(); y++)
+				{
+					uint64_t* row = &planes[plane][y * WORDS_PER_ROW];
+					row[0] = (row[0] << pixels) | (row[1] >> (64 - pixels));
+					row[1] = row[1] << pixels;
+				}
+			}
+		}
+	}
+
+	void Framebuffer::scrollRight(unsigned int pixels, unsigned char planeMask)
+	{
+		if(pixels == 0 || pixels >= 64)
+		{
+			return;
+		}
+
+		for(unsigned int plane = 0; plane < PLANE_COUNT; plane++)
+		{
+			if(planeMask & (1 << plane))
+			{
+				for(unsigned int y = 0; y < getHeight(); y++)
+				{
+					uint64_t* row = &planes[plane][y * WORDS_PER_ROW];
+					row[1] = (row[1] >> pixels) | (row[0] << (64 - pixels));
+					row[0] = row[0] >> pixels;
+					clipRow(row);
+				}
+			}
+		}
+	}
+
+	bool Framebuffer::drawSpriteRow(unsigned int plane, unsigned int x, unsigned int y, uint16_t bits, bool wrap)
+	{
+		uint64_t sprite[WORDS_PER_ROW] = {0, 0};
+		placeBits(bits, x, sprite);
+		clipRow(sprite);
+
+		//Pixels that ran past the right edge come back in at the left edge.
+		unsigned int width = getWidth();
+		if(wrap && x + 16 > width)
+		{
+			uint64_t wrapped[WORDS_PER_ROW] = {0, 0};
+			placeBits((uint16_t)(bits << (width - x)), 0, wrapped);
+			sprite[0] |= wrapped[0];
+			sprite[1] |= wrapped[1];
+		}
+
+		uint64_t* row = &planes[plane][y * WORDS_PER_ROW];
+
+		bool collision = ((row[0] & sprite[0]) | (row[1] & sprite[1])) != 0;
+		row[0] ^= sprite[0];
+		row[1] ^= sprite[1];
+
+		return collision;
+	}
+
+	unsigned char Framebuffer::getPixel(unsigned int x, unsigned int y) const
+	{
+		unsigned int word = y * WORDS_PER_ROW + x / 64;
+		unsigned int shift = 63 - (x % 64);
+
+		return (unsigned char)(((planes[0][word] >> shift) & 1) | (((planes[1][word] >> shift) & 1) << 1));
+	}
+
+	const uint64_t* Framebuffer::getRow(unsigned int plane, unsigned int y) const
+	{
+		return &planes[plane][y * WORDS_PER_ROW];
+	}
+
+	bool Framebuffer::operator==(const Framebuffer& other) const
+	{
+		return hiRes == other.hiRes && planes == other.planes;
+	}
+
+	void Framebuffer::placeBits(uint16_t bits, unsigned int x, uint64_t* sprite)
+	{
+		//Line the 16 sprite pixels up so that the most significant one lands on pixel x. Whatever runs past
+		//pixel 127 is shifted out.
+		if(x <= 48)
+		{
+			sprite[0] = (uint64_t)bits << (48 - x);
+		}
+		else if(x < 64)
+		{
+			sprite[0] = (uint64_t)bits >> (x - 48);
+			sprite[1] = (uint64_t)bits << (112 - x);
+		}
+		else if(x <= 112)
+		{
+			sprite[1] = (uint64_t)bits << (112 - x);
+		}
+		else
+		{
+			sprite[1] = (uint64_t)bits >> (x - 112);
+		}
+	}
+
+	void Framebuffer::clipRow(uint64_t* row)
+	{
+		if(!hiRes)
+		{
+			row[1] = 0;
+		}
+	}
+}
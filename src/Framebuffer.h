@@ -0,0 +1,45 @@
+#ifndef EMU_8_FRAMEBUFFER_H
+#define EMU_8_FRAMEBUFFER_H
+
+#include <array>
+#include <cstdint>
+
+namespace Emu8
+{
+	//Up to two 128x64 bitplanes. Each row is packed into two 64 bit words with the leftmost pixel in the most
+	//significant bit, so scrolling and sprite drawing work on whole rows instead of single pixels. In low
+	//resolution only the first 32 rows and the first word of each row are in use.
+	class Framebuffer
+	{
+	public:
+		static const unsigned int MAX_WIDTH = 128;
+		static const unsigned int MAX_HEIGHT = 64;
+		static const unsigned int PLANE_COUNT = 2;
+		static const unsigned int WORDS_PER_ROW = 2;
+
+	private:
+		std::array<std::array<uint64_t, MAX_HEIGHT * WORDS_PER_ROW>, PLANE_COUNT> planes;
+		bool hiRes;
+
+		void clipRow(uint64_t* row);
+		void placeBits(uint16_t bits, unsigned int x, uint64_t* sprite);
+
+	public:
+		Framebuffer();
+		unsigned int getWidth() const;
+		unsigned int getHeight() const;
+		bool isHiRes() const;
+		void setHiRes(bool hiRes);
+		void clear(unsigned char planeMask);
+		void scrollDown(unsigned int rows, unsigned char planeMask);
+		void scrollUp(unsigned int rows, unsigned char planeMask);
+		void scrollLeft(unsigned int pixels, unsigned char planeMask);
+		void scrollRight(unsigned int pixels, unsigned char planeMask);
+		bool drawSpriteRow(unsigned int plane, unsigned int x, unsigned int y, uint16_t bits, bool wrap);
+		unsigned char getPixel(unsigned int x, unsigned int y) const;
+		const uint64_t* getRow(unsigned int plane, unsigned int y) const;
+		bool operator==(const Framebuffer& other) const;
+	};
+}
+
+#endif //EMU_8_FRAMEBUFFER_H
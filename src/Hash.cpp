@@ -0,0 +1,27 @@
+#include "Hash.h"
+#include <cstdio>
+#include <string>
+
+namespace Emu8
+{
+	uint64_t Hash::Fnv1a(const void* data, size_t size, uint64_t hash)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+
+		for(size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+
+		return hash;
+	}
+
+	std::string Hash::ToHex(uint64_t hash)
+	{
+		char text[17];
+		std::snprintf(text, sizeof(text), "%016llx", (unsigned long long)hash);
+
+		return std::string(text);
+	}
+}
@@ -0,0 +1,20 @@
+#ifndef EMU_8_HASH_H
+#define EMU_8_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Emu8
+{
+	class Hash
+	{
+	public:
+		static const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+
+		static uint64_t Fnv1a(const void* data, size_t size, uint64_t hash = FNV_OFFSET_BASIS);
+		static std::string ToHex(uint64_t hash);
+	};
+}
+
+#endif //EMU_8_HASH_H
@@ -0,0 +1,26 @@
+#ifndef EMU_8_HUDFONT_H
+#define EMU_8_HUDFONT_H
+
+#include <cstdint>
+#include <string>
+
+namespace Emu8
+{
+	//A 5x7 bitmap font covering printable ASCII, compiled in so the overlay needs neither SDL_ttf nor a font file.
+	//Each glyph is seven rows from the top with the leftmost pixel in bit 4.
+	class HudFont
+	{
+	public:
+		static const unsigned int GLYPH_WIDTH = 5;
+		static const unsigned int GLYPH_HEIGHT = 7;
+		static const unsigned int ADVANCE = GLYPH_WIDTH + 1;
+		static const char FIRST_CHARACTER = ' ';
+		static const char LAST_CHARACTER = '~';
+
+		static unsigned char GetGlyphRow(char character, unsigned int row);
+		static unsigned int GetTextWidth(const char* text, unsigned int scale);
+		static void Draw(uint32_t* pixels, unsigned int pitch, unsigned int width, unsigned int height, unsigned int x, unsigned int y, const char* text, uint32_t color, unsigned int scale);
+	};
+}
+
+#endif //EMU_8_HUDFONT_H
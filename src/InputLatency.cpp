@@ -0,0 +1,82 @@
+#include "InputLatency.h"
+#include <algorithm>
+
+namespace Emu8
+{
+	const unsigned int InputLatency::SAMPLE_COUNT;
+
+	InputLatency::InputLatency()
+			: eventTimes(), readTimes(), awaitingRead(0), awaitingShown(0), samples(), scratch()
+	{
+	}
+
+	void InputLatency::keyEvent(unsigned char key, double time)
+	{
+		//A key that changes again before the program looked at it is timed from its first change.
+		uint16_t bit = (uint16_t)(1 << (key & 0xF));
+		if(!(awaitingRead & bit))
+		{
+			eventTimes[key & 0xF] = time;
+			awaitingRead |= bit;
+		}
+	}
+
+	void InputLatency::keysRead(uint16_t keys, double time)
+	{
+		uint16_t noticed = keys & awaitingRead;
+		for(unsigned int key = 0; noticed != 0 && key < 16; key++)
+		{
+			if(noticed & (1 << key))
+			{
+				addSample(LatencyStage::EventToRead, time - eventTimes[key]);
+				if(!(awaitingShown & (1 << key)))
+				{
+					readTimes[key] = time;
+				}
+			}
+		}
+
+		awaitingRead &= ~noticed;
+		awaitingShown |= noticed;
+	}
+
+	void InputLatency::frameShown(double time)
+	{
+		for(unsigned int key = 0; awaitingShown != 0 && key < 16; key++)
+		{
+			if(awaitingShown & (1 << key))
+			{
+				addSample(LatencyStage::ReadToShown, time - readTimes[key]);
+			}
+		}
+
+		awaitingShown = 0;
+	}
+
+	unsigned int InputLatency::getSampleCount(LatencyStage stage) const
+	{
+		return samples[(unsigned int)stage].count;
+	}
+
+	double InputLatency::getPercentile(LatencyStage stage, double percentile) const
+	{
+		const Samples& stageSamples = samples[(unsigned int)stage];
+		if(stageSamples.count == 0)
+		{
+			return 0;
+		}
+
+		std::copy(stageSamples.values.begin(), stageSamples.values.begin() + stageSamples.count, scratch.begin());
+		unsigned int rank = (unsigned int)(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * (stageSamples.count - 1) + 0.5);
+		std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.begin() + stageSamples.count);
+		return scratch[rank];
+	}
+
+	void InputLatency::addSample(LatencyStage stage, double latency)
+	{
+		Samples& stageSamples = samples[(unsigned int)stage];
+		stageSamples.values[stageSamples.next] = latency;
+		stageSamples.next = (stageSamples.next + 1) % SAMPLE_COUNT;
+		stageSamples.count = std::min(stageSamples.count + 1, SAMPLE_COUNT);
+	}
+}
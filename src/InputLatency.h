@@ -0,0 +1,49 @@
+#ifndef EMU_8_INPUTLATENCY_H
+#define EMU_8_INPUTLATENCY_H
+
+#include <array>
+#include <cstdint>
+
+namespace Emu8
+{
+	enum class LatencyStage
+	{
+		EventToRead, //From the key event to the first Ex9E/ExA1/Fx0A that looked at the key.
+		ReadToShown //From there to the frame that was flipped after it.
+	};
+
+	//Follows each key event through the frame loop and keeps the last SAMPLE_COUNT latencies of every stage. Times
+	//are in milliseconds on whatever clock the caller uses. Nothing here allocates, it runs inside the frame loop.
+	class InputLatency
+	{
+	public:
+		static const unsigned int SAMPLE_COUNT = 256;
+
+	private:
+		struct Samples
+		{
+			std::array<double, SAMPLE_COUNT> values;
+			unsigned int count;
+			unsigned int next;
+		};
+
+		std::array<double, 16> eventTimes;
+		std::array<double, 16> readTimes;
+		uint16_t awaitingRead;
+		uint16_t awaitingShown;
+		std::array<Samples, 2> samples;
+		mutable std::array<double, SAMPLE_COUNT> scratch;
+
+		void addSample(LatencyStage stage, double latency);
+
+	public:
+		InputLatency();
+		void keyEvent(unsigned char key, double time);
+		void keysRead(uint16_t keys, double time);
+		void frameShown(double time);
+		unsigned int getSampleCount(LatencyStage stage) const;
+		double getPercentile(LatencyStage stage, double percentile) const;
+	};
+}
+
+#endif //EMU_8_INPUTLATENCY_H
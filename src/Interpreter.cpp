@@ -0,0 +1,790 @@
+#include "Interpreter.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include "Console.h"
+
+namespace Emu8
+{
+	template<typename Quirks>
+	Interpreter<Quirks>::Interpreter()
+			: Machine(), idleCandidate(false)
+	{
+		memorySize = Quirks::memorySize;
+		aotContext.interpret = &Interpreter<Quirks>::InterpretInstruction;
+	}
+
+	template<typename Quirks>
+	Profile Interpreter<Quirks>::getProfile() const
+	{
+		return Quirks::profile;
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::runFrame()
+	{
+		//Nothing below pays for the debugger unless it has something armed.
+		if(debugger != nullptr && debugger->isActive())
+		{
+			runDebugFrame();
+			return;
+		}
+
+		unsigned int cyclesLeft = frameCyclesLeft > 0 ? frameCyclesLeft : cyclesPerFrame;
+		frameCyclesLeft = 0;
+
+		//A frame that starts on a loop already known to idle is skipped before running up to its jump back. With the
+		//loops from the analysis cache that holds from the first frame on.
+		if(!state.waitingForKey && !state.halted && isIdleLoop(state.programCounter))
+		{
+			skipIdleLoop(cyclesLeft);
+		}
+
+		while(cyclesLeft > 0 && !state.waitingForKey && !state.halted)
+		{
+			if(aotRunner != nullptr && !state.codeModified)
+			{
+				unsigned int executed = aotRunner(&aotContext, cyclesLeft);
+
+				if(executed > 0)
+				{
+					stats.instructionsExecuted += executed;
+					cyclesLeft -= executed;
+
+					if(aotContext.idleCandidate)
+					{
+						aotContext.idleCandidate = false;
+						skipIdleLoop(cyclesLeft);
+					}
+					continue;
+				}
+			}
+
+			if(coverageMap != nullptr)
+			{
+				coverageMap[state.programCounter & coverageMask]++;
+			}
+
+			runInstruction(state.mainMem[Wrap(state.programCounter)], state.mainMem[Wrap(state.programCounter + 1)]);
+			stats.instructionsExecuted++;
+			cyclesLeft--;
+
+			if(idleCandidate)
+			{
+				idleCandidate = false;
+				skipIdleLoop(cyclesLeft);
+			}
+		}
+
+		tickTimers();
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::runDebugFrame()
+	{
+		//runFrame without the translated code and the idle loop skipping, so every instruction goes past the
+		//debugger. A pause part way through the frame leaves the rest of its cycles for when it resumes.
+		unsigned int cyclesLeft = frameCyclesLeft > 0 ? frameCyclesLeft : cyclesPerFrame;
+
+		while(cyclesLeft > 0 && !state.waitingForKey && !state.halted)
+		{
+			unsigned short instruction = (unsigned short)((state.mainMem[Wrap(state.programCounter)] << 8) | state.mainMem[Wrap(state.programCounter + 1)]);
+
+			if(debugger->isPaused() || debugger->beforeInstruction(state, getMemoryAccess(instruction)))
+			{
+				frameCyclesLeft = cyclesLeft;
+				return;
+			}
+
+			if(coverageMap != nullptr)
+			{
+				coverageMap[state.programCounter & coverageMask]++;
+			}
+
+			runInstruction((unsigned char)(instruction >> 8), (unsigned char)(instruction & 0xFF));
+			stats.instructionsExecuted++;
+			cyclesLeft--;
+			idleCandidate = false;
+
+			debugger->afterInstruction(state);
+		}
+
+		frameCyclesLeft = 0;
+		tickTimers();
+	}
+
+	template<typename Quirks>
+	MemoryAccess Interpreter<Quirks>::getMemoryAccess(unsigned short instruction) const
+	{
+		//Only data accesses are reported, fetching instructions is not a read as far as watchpoints go.
+		unsigned char xReg = (unsigned char)((instruction & 0x0F00) >> 8);
+		unsigned char yReg = (unsigned char)((instruction & 0x00F0) >> 4);
+		unsigned char nibble = (unsigned char)(instruction & 0x000F);
+		unsigned short iRegister = Wrap(state.iRegister);
+		MemoryAccess access = {iRegister, 0, false};
+
+		switch(instruction & 0xF0FF)
+		{
+			case 0xF033:
+				access.length = 3;
+				access.write = true;
+				break;
+			case 0xF055:
+				access.length = xReg + 1u;
+				access.write = true;
+				break;
+			case 0xF065:
+				access.length = xReg + 1u;
+				break;
+			case 0xF002:
+				access.length = Quirks::xoChipInstructions ? (unsigned int)state.audioPattern.size() : 0;
+				break;
+			default:
+				break;
+		}
+
+		if(Quirks::xoChipInstructions && (instruction & 0xF00E) == 0x5002) //5xy2, 5xy3
+		{
+			access.length = (unsigned int)std::abs(yReg - xReg) + 1;
+			access.write = nibble == 0x2;
+		}
+		else if((instruction & 0xF000) == 0xD000)
+		{
+			unsigned int planes = (state.planeMask & 1) + ((state.planeMask >> 1) & 1);
+			unsigned int bytes = nibble == 0 ? (Quirks::superChipInstructions ? 32 : 0) : nibble;
+			access.length = bytes * planes;
+		}
+
+		return access;
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::skipIdleLoop(unsigned int& cyclesLeft)
+	{
+		//The program counter is sitting on the target of a short backwards jump. If the loop body only polls the
+		//delay timer or the keypad, nothing it reads can change before the end of this frame, so the rest of the
+		//frame's cycles can be accounted for in one go instead of spinning through them.
+		std::array<unsigned char, 65536>& mainMem = state.mainMem;
+		unsigned short loopStart = state.programCounter;
+
+		if(cyclesLeft == 0 || loopStart > Quirks::memorySize - 6)
+		{
+			return;
+		}
+
+		unsigned short first = (unsigned short)((mainMem[loopStart] << 8) | mainMem[loopStart + 1]);
+		unsigned short second = (unsigned short)((mainMem[loopStart + 2] << 8) | mainMem[loopStart + 3]);
+		unsigned short third = (unsigned short)((mainMem[loopStart + 4] << 8) | mainMem[loopStart + 5]);
+		unsigned short jumpBack = (unsigned short)(0x1000 | loopStart);
+		unsigned int loopLength = 0;
+
+		if(first == jumpBack) //1nnn onto itself
+		{
+			loopLength = 1;
+		}
+		else if(second == jumpBack && (first & 0xF000) == 0xE000) //Ex9E/ExA1, 1nnn
+		{
+			unsigned char key = state.vReg[(first & 0x0F00) >> 8] & 0xF;
+			bool keyPressed = state.keys[key];
+			state.keysPolled |= (uint16_t)(1 << key);
+
+			if(((first & 0x00FF) == 0x9E && !keyPressed) || ((first & 0x00FF) == 0xA1 && keyPressed))
+			{
+				loopLength = 2;
+			}
+		}
+		else if(third == jumpBack && (first & 0xF0FF) == 0xF007 && ((second & 0xF000) == 0x3000 || (second & 0xF000) == 0x4000) && (second & 0x0F00) == (first & 0x0F00)) //Fx07, 3xkk/4xkk, 1nnn
+		{
+			bool timerMatches = state.delayRegister == (second & 0x00FF);
+
+			if(((second & 0xF000) == 0x3000 && !timerMatches) || ((second & 0xF000) == 0x4000 && timerMatches))
+			{
+				loopLength = 3;
+			}
+		}
+
+		if(loopLength == 0)
+		{
+			return;
+		}
+
+		noteIdleLoop(loopStart);
+
+		//Leave the machine exactly where executing the remaining cycles would have left it.
+		if(loopLength == 3)
+		{
+			state.vReg[(first & 0x0F00) >> 8] = state.delayRegister;
+		}
+		state.programCounter = (unsigned short)(loopStart + (cyclesLeft % loopLength) * 2);
+
+		stats.instructionsSkipped += cyclesLeft;
+		cyclesLeft = 0;
+	}
+
+	template<typename Quirks>
+	unsigned short Interpreter<Quirks>::Wrap(unsigned int address)
+	{
+		//Addresses past the end of memory wrap around instead of running off the end of mainMem.
+		return (unsigned short)(address & (Quirks::memorySize - 1));
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::InterpretInstruction(void* machine, unsigned short instruction)
+	{
+		((Interpreter<Quirks>*)machine)->runInstruction((unsigned char)(instruction >> 8), (unsigned char)(instruction & 0xFF));
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::runInstruction(unsigned char upper, unsigned char lower)
+	{
+		std::array<unsigned char, 65536>& mainMem = state.mainMem;
+		std::array<unsigned char, 16>& vReg = state.vReg;
+		unsigned short& programCounter = state.programCounter;
+		unsigned short& iRegister = state.iRegister;
+
+		unsigned short fullInstruction = (upper << 8) | lower; //Full two byte instruction pulled from memory.
+		unsigned char header = (unsigned char)(upper & 0xF0) >> 4; //The upper 4 bits of the instruction.
+		unsigned short address = (unsigned short)(fullInstruction & 0x0FFF); //The lowest 12 bits of the instruction.
+		unsigned char nibble = (unsigned char)(lower & 0x0F); //The lowest 4 bits of the instruction.
+		unsigned char xReg = (unsigned char)(upper & 0x0F); //The lower 4 bits of the high byte of the instruction.
+		unsigned char yReg = (unsigned char)(lower & 0xF0) >> 4; //The upper 4 bits of the low byte of the instruction.
+		unsigned char kk = lower; //The lowest 8 bits of the instruction.
+
+		switch(header)
+		{
+			case 0x00:
+			{
+				switch(fullInstruction)
+				{
+					case 0x00E0: //Clear the display
+					{
+						state.framebuffer.clear(state.planeMask);
+						programCounter += 2;
+						break;
+					}
+					case 0x00EE: //Return from subroutine
+					{
+						if(state.stackPointer == 0)
+						{
+							Console::Print("Returned with an empty stack, halting.");
+							state.halted = true;
+							break;
+						}
+						programCounter = state.stackMem[--state.stackPointer];
+						break;
+					}
+					default:
+					{
+						if(Quirks::superChipInstructions)
+						{
+							if(fullInstruction == 0x00FB) //Scroll the display right by 4 pixels
+							{
+								state.framebuffer.scrollRight(4, state.planeMask);
+							}
+							else if(fullInstruction == 0x00FC) //Scroll the display left by 4 pixels
+							{
+								state.framebuffer.scrollLeft(4, state.planeMask);
+							}
+							else if(fullInstruction == 0x00FD) //Exit the interpreter
+							{
+								state.halted = true;
+								break;
+							}
+							else if(fullInstruction == 0x00FE) //Switch to low resolution (64x32)
+							{
+								state.framebuffer.setHiRes(false);
+							}
+							else if(fullInstruction == 0x00FF) //Switch to high resolution (128x64)
+							{
+								state.framebuffer.setHiRes(true);
+							}
+							else if((fullInstruction & 0xFFF0) == 0x00C0) //Scroll the display down by n pixels
+							{
+								state.framebuffer.scrollDown(nibble, state.planeMask);
+							}
+							else if(Quirks::xoChipInstructions && (fullInstruction & 0xFFF0) == 0x00D0) //Scroll the display up by n pixels
+							{
+								state.framebuffer.scrollUp(nibble, state.planeMask);
+							}
+						}
+						//Anything else is a jump to a system address, which is ignored.
+						programCounter += 2;
+						break;
+					}
+				}
+				break;
+			}
+			case 0x01: //Jump to address
+			{
+				//A jump onto itself or a couple of instructions back may be a polling loop, see skipIdleLoop.
+				idleCandidate = address <= programCounter && programCounter - address <= 4;
+				programCounter = address;
+				break;
+			}
+			case 0x02: //Call subroutine at address
+			{
+				if(state.stackPointer == state.stackMem.size())
+				{
+					Console::Print("Stack overflow, halting.");
+					state.halted = true;
+					break;
+				}
+				programCounter += 2;
+				state.stackMem[state.stackPointer++] = programCounter;
+				programCounter = address;
+				break;
+			}
+			case 0x03: //Skip the next instruction if Vx == kk
+			{
+				if(vReg[xReg] == kk)
+				{
+					skipInstruction();
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x04: //Skip the next instruction if Vx != kk
+			{
+				if(vReg[xReg] != kk)
+				{
+					skipInstruction();
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x05:
+			{
+				switch(nibble)
+				{
+					case 0x00: //Skip the next instruction if Vx == Vy
+					{
+						if(vReg[xReg] == vReg[yReg])
+						{
+							skipInstruction();
+						}
+						break;
+					}
+					case 0x02: //Store registers Vx through Vy in memory starting at location I
+					{
+						if(!Quirks::xoChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of 5!");
+							break;
+						}
+
+						noteStore(Wrap(iRegister), std::abs(yReg - xReg) + 1);
+
+						for(int i = 0, step = xReg <= yReg ? 1 : -1; i <= std::abs(yReg - xReg); i++)
+						{
+							mainMem[Wrap(iRegister + i)] = vReg[xReg + i * step];
+						}
+						break;
+					}
+					case 0x03: //Read registers Vx through Vy from memory starting at location I
+					{
+						if(!Quirks::xoChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of 5!");
+							break;
+						}
+
+						for(int i = 0, step = xReg <= yReg ? 1 : -1; i <= std::abs(yReg - xReg); i++)
+						{
+							vReg[xReg + i * step] = mainMem[Wrap(iRegister + i)];
+						}
+						break;
+					}
+					default:
+					{
+						Console::Print("Unknown instruction has been read with a header of 5!");
+						break;
+					}
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x06: //Set Vx = kk
+			{
+				vReg[xReg] = kk;
+				programCounter += 2;
+				break;
+			}
+			case 0x07: // Set Vx = Vx + kk
+			{
+				vReg[xReg] = kk + vReg[xReg];
+				programCounter += 2;
+				break;
+			}
+			case 0x08:
+			{
+				switch(nibble)
+				{
+					case 0x00: //Set Vx = Vy
+					{
+						vReg[xReg] = vReg[yReg];
+						break;
+					}
+					case 0x01: //Set Vx = Vx OR Vy
+					{
+						vReg[xReg] = vReg[xReg] | vReg[yReg];
+						if(Quirks::logicResetsVf)
+						{
+							vReg[15] = 0;
+						}
+						break;
+					}
+					case 0x02: //Set Vx = Vx AND Vy
+					{
+						vReg[xReg] = vReg[xReg] & vReg[yReg];
+						if(Quirks::logicResetsVf)
+						{
+							vReg[15] = 0;
+						}
+						break;
+					}
+					case 0x03: //Set Vx = Vx XOR Vy
+					{
+						vReg[xReg] = vReg[xReg] ^ vReg[yReg];
+						if(Quirks::logicResetsVf)
+						{
+							vReg[15] = 0;
+						}
+						break;
+					}
+					case 0x04: //Set Vx = Vx + Vy, set VF = carry
+					{
+						vReg[15] = vReg[xReg] > (255 - vReg[yReg]) ? (unsigned char)1 : (unsigned char)0;
+						vReg[xReg] = vReg[xReg] + vReg[yReg];
+						break;
+					}
+					case 0x05: //Set Vx = Vx - Vy, set VF = NOT borrow
+					{
+						vReg[15] = vReg[xReg] > vReg[yReg] ? (unsigned char)1 : (unsigned char)0;
+						vReg[xReg] = vReg[xReg] - vReg[yReg];
+						break;
+					}
+					case 0x06: //Set Vx = Vx SHR 1, or Vx = Vy SHR 1
+					{
+						unsigned char source = Quirks::shiftUsesVy ? vReg[yReg] : vReg[xReg];
+						vReg[xReg] = source / (unsigned char)2;
+						vReg[15] = source & 0x1 ? (unsigned char)1 : (unsigned char)0;
+						break;
+					}
+					case 0x07: //Set Vx = Vy - Vx, set VF = NOT borrow
+					{
+						vReg[15] = vReg[yReg] > vReg[xReg] ? (unsigned char)1 : (unsigned char)0;
+						vReg[xReg] = vReg[yReg] - vReg[xReg];
+						break;
+					}
+					case 0x0E: //Set Vx = Vx SHL 1, or Vx = Vy SHL 1
+					{
+						unsigned char source = Quirks::shiftUsesVy ? vReg[yReg] : vReg[xReg];
+						vReg[xReg] = source * (unsigned char)2;
+						vReg[15] = source & 0x80 ? (unsigned char)1 : (unsigned char)0;
+						break;
+					}
+					default:
+					{
+						Console::Print("Unknown instruction has been read with a header of 8!");
+						break;
+					}
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x09: //Skip next instruction if Vx != Vy
+			{
+				if(vReg[xReg] != vReg[yReg])
+				{
+					skipInstruction();
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x0A: //Set I = nnn
+			{
+				iRegister = address;
+				programCounter += 2;
+				break;
+			}
+			case 0x0B: //Jump to location nnn + V0, or xnn + Vx
+			{
+				programCounter = address + (Quirks::jumpUsesVx ? vReg[xReg] : vReg[0]);
+				break;
+			}
+			case 0x0C: //Set Vx = random byte AND kk
+			{
+				state.randomState = (uint32_t)((uint64_t)state.randomState * 48271u % 2147483647u);
+				unsigned char randomNumber = (unsigned char)(state.randomState % 256);
+				vReg[xReg] = randomNumber & kk;
+				programCounter += 2;
+				break;
+			}
+			case 0x0D: //Display n-byte sprite starting at memory location I at (Vx, Vy), set VF = collision
+			{
+				drawSprite(vReg[xReg], vReg[yReg], nibble);
+				programCounter += 2;
+				break;
+			}
+			case 0x0E:
+			{
+				switch(kk)
+				{
+					case 0x9E: //Skip next instruction if key with the value of Vx is pressed
+					{
+						state.keysPolled |= (uint16_t)(1 << (vReg[xReg] & 0xF));
+						if(state.keys[vReg[xReg] & 0xF])
+						{
+							skipInstruction();
+						}
+						break;
+					}
+					case 0xA1: //Skip next instruction if key with the value of Vx is not pressed
+					{
+						state.keysPolled |= (uint16_t)(1 << (vReg[xReg] & 0xF));
+						if(!state.keys[vReg[xReg] & 0xF])
+						{
+							skipInstruction();
+						}
+						break;
+					}
+					default:
+					{
+						Console::Print("Unknown instruction has been read with a header of E!");
+						break;
+					}
+				}
+				programCounter += 2;
+				break;
+			}
+			case 0x0F:
+			{
+				if(Quirks::xoChipInstructions && fullInstruction == 0xF000) //Set I = nnnn, the 16 bit address following this instruction
+				{
+					iRegister = (unsigned short)((mainMem[Wrap(programCounter + 2)] << 8) | mainMem[Wrap(programCounter + 3)]);
+					programCounter += 4;
+					break;
+				}
+
+				switch(kk)
+				{
+					case 0x01: //Select the drawing planes given by x
+					{
+						if(!Quirks::xoChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+						state.planeMask = (unsigned char)(xReg & 0x3);
+						break;
+					}
+					case 0x02: //Load the 16 byte audio pattern starting at location I
+					{
+						if(!Quirks::xoChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+
+						for(unsigned char i = 0; i < state.audioPattern.size(); i++)
+						{
+							state.audioPattern[i] = mainMem[Wrap(iRegister + i)];
+						}
+						break;
+					}
+					case 0x07: //Set Vx = delay timer value
+					{
+						vReg[xReg] = state.delayRegister;
+						break;
+					}
+					case 0x0A: //Wait for a key press, store the value of the key in Vx
+					{
+						state.waitingForKey = true;
+						state.keyRegister = xReg;
+						break;
+					}
+					case 0x15: //Set delay timer = Vx
+					{
+						state.delayRegister = vReg[xReg];
+						break;
+					}
+					case 0x18: //Set sound timer = Vx
+					{
+						state.soundRegister = vReg[xReg];
+						break;
+					}
+					case 0x1E: //Set I = I + Vx
+					{
+						iRegister = iRegister + vReg[xReg];
+						break;
+					}
+					case 0x29: //Set I = location of sprite for digit Vx
+					{
+						iRegister = vReg[xReg] * (unsigned short)5;
+						break;
+					}
+					case 0x30: //Set I = location of the large sprite for digit Vx
+					{
+						if(!Quirks::superChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+						iRegister = (unsigned short)(BIG_FONT_ADDRESS + (vReg[xReg] & 0xF) * 10);
+						break;
+					}
+					case 0x33: //Store BCD representation of Vx in memory locations I, I+1, and I+2
+					{
+						noteStore(Wrap(iRegister), 3);
+						mainMem[Wrap(iRegister)] = (unsigned char)(vReg[xReg] / 100);
+						mainMem[Wrap(iRegister + 1)] = (unsigned char)((vReg[xReg] / 10) % 10);
+						mainMem[Wrap(iRegister + 2)] = (unsigned char)((vReg[xReg] % 100) % 10);
+						break;
+					}
+					case 0x55: //Store registers V0 through Vx in memory starting at location I
+					{
+						noteStore(Wrap(iRegister), xReg + 1);
+						for(unsigned char i = 0; i <= xReg; i++)
+						{
+							mainMem[Wrap(iRegister + i)] = vReg[i];
+						}
+
+						if(Quirks::loadStoreIncrement == IndexIncrement::ByX)
+						{
+							iRegister += xReg;
+						}
+						else if(Quirks::loadStoreIncrement == IndexIncrement::ByXPlusOne)
+						{
+							iRegister += xReg + 1;
+						}
+						break;
+					}
+					case 0x65: //Read registers V0 through Vx from memory starting at location I
+					{
+						for(unsigned char i = 0; i <= xReg; i++)
+						{
+							vReg[i] = mainMem[Wrap(iRegister + i)];
+						}
+
+						if(Quirks::loadStoreIncrement == IndexIncrement::ByX)
+						{
+							iRegister += xReg;
+						}
+						else if(Quirks::loadStoreIncrement == IndexIncrement::ByXPlusOne)
+						{
+							iRegister += xReg + 1;
+						}
+						break;
+					}
+					case 0x75: //Store registers V0 through Vx in the RPL user flags
+					{
+						if(!Quirks::superChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+						std::copy(vReg.begin(), vReg.begin() + xReg + 1, state.rplFlags.begin());
+						break;
+					}
+					case 0x85: //Read registers V0 through Vx from the RPL user flags
+					{
+						if(!Quirks::superChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+						std::copy(state.rplFlags.begin(), state.rplFlags.begin() + xReg + 1, vReg.begin());
+						break;
+					}
+					case 0x3A: //Set the audio pattern pitch = Vx
+					{
+						if(!Quirks::xoChipInstructions)
+						{
+							Console::Print("Unknown instruction has been read with a header of F!");
+							break;
+						}
+						state.audioPitch = vReg[xReg];
+						break;
+					}
+					default:
+					{
+						Console::Print("Unknown instruction has been read with a header of F!");
+						break;
+					}
+				}
+				programCounter += 2;
+				break;
+			}
+			default:
+			{
+				Console::Print("Unknown instruction has been read, IGNORE ME!!!");
+				programCounter += 2;
+				break;
+			}
+		}
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::skipInstruction()
+	{
+		//F000 nnnn is the only four byte instruction, and it has to be skipped as a whole.
+		unsigned short next = (unsigned short)(state.programCounter + 2);
+		bool isLongInstruction = Quirks::xoChipInstructions && state.mainMem[Wrap(next)] == 0xF0 && state.mainMem[Wrap(next + 1)] == 0x00;
+
+		state.programCounter += isLongInstruction ? 4 : 2;
+	}
+
+	template<typename Quirks>
+	void Interpreter<Quirks>::drawSprite(unsigned char x, unsigned char y, unsigned char height)
+	{
+		//Set the flag register to zero, for if there is a collision it will be set to one.
+		state.vReg[15] = 0;
+
+		//A height of zero draws a 16x16 sprite, two bytes per row. On the original interpreter it draws nothing.
+		if(height == 0 && !Quirks::superChipInstructions)
+		{
+			return;
+		}
+
+		unsigned int rows = height == 0 ? 16 : height;
+		unsigned int bytesPerRow = height == 0 ? 2 : 1;
+		unsigned int startX = x % state.framebuffer.getWidth();
+		unsigned int startY = y % state.framebuffer.getHeight();
+		unsigned short memLocation = state.iRegister;
+
+		//Each selected plane consumes its own run of sprite data, one after the other.
+		for(unsigned int plane = 0; plane < Framebuffer::PLANE_COUNT; plane++)
+		{
+			if(!(state.planeMask & (1 << plane)))
+			{
+				continue;
+			}
+
+			for(unsigned int iY = 0; iY < rows; iY++, memLocation += bytesPerRow)
+			{
+				//Rows that fall off the bottom of the display are clipped, or wrap back to the top.
+				unsigned int drawY = startY + iY;
+				if(drawY >= state.framebuffer.getHeight())
+				{
+					if(!Quirks::spritesWrap)
+					{
+						continue;
+					}
+					drawY -= state.framebuffer.getHeight();
+				}
+
+				uint16_t bits = bytesPerRow == 2 ? (uint16_t)((state.mainMem[Wrap(memLocation)] << 8) | state.mainMem[Wrap(memLocation + 1)]) : (uint16_t)(state.mainMem[Wrap(memLocation)] << 8);
+
+				if(state.framebuffer.drawSpriteRow(plane, startX, drawY, bits, Quirks::spritesWrap))
+				{
+					state.vReg[15] = 1;
+				}
+			}
+		}
+	}
+
+	template class Interpreter<CosmacVipQuirks>;
+	template class Interpreter<Chip48Quirks>;
+	template class Interpreter<SuperChipQuirks>;
+	template class Interpreter<XoChipQuirks>;
+}
@@ -0,0 +1,35 @@
+#ifndef EMU_8_INTERPRETER_H
+#define EMU_8_INTERPRETER_H
+
+#include "Debugger.h"
+#include "Machine.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	//The instruction interpreter for one quirk policy. Instantiated for each of the standard profiles in
+	//Interpreter.cpp, use Machine::Create to pick one at runtime.
+	template<typename Quirks>
+	class Interpreter : public Machine
+	{
+	private:
+		bool idleCandidate;
+
+		void runDebugFrame();
+		void runInstruction(unsigned char upper, unsigned char lower);
+		MemoryAccess getMemoryAccess(unsigned short instruction) const;
+		void skipIdleLoop(unsigned int& cyclesLeft);
+		void skipInstruction();
+		void drawSprite(unsigned char x, unsigned char y, unsigned char height);
+
+		static unsigned short Wrap(unsigned int address);
+		static void InterpretInstruction(void* machine, unsigned short instruction);
+
+	public:
+		Interpreter();
+		Profile getProfile() const override;
+		void runFrame() override;
+	};
+}
+
+#endif //EMU_8_INTERPRETER_H
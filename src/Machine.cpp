@@ -0,0 +1,360 @@
+#include "Machine.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "AotModule.h"
+#include "Console.h"
+#include "File.h"
+#include "Hash.h"
+#include "Interpreter.h"
+
+namespace Emu8
+{
+	Machine::Machine()
+			: state(), stats(), cyclesPerFrame(DEFAULT_CYCLES_PER_FRAME), memorySize(65536), coverageMap(nullptr), coverageMask(), dirtyPages(), romHash(), romSize(), aotModule(), aotContext(), aotRunner(nullptr), debugger(nullptr), frameCyclesLeft(), idleLoops(), idleLoopCount(0)
+	{
+		state.programCounter = PROGRAM_START;
+		state.planeMask = 1;
+		state.audioPitch = 64;
+		state.randomState = 1;
+		aotContext.state = &state;
+		aotContext.machine = this;
+
+		loadFontData();
+	}
+
+	Machine::~Machine()
+	{
+	}
+
+	std::unique_ptr<Machine> Machine::Create(Profile profile)
+	{
+		switch(profile)
+		{
+			case Profile::Chip48:
+				return std::unique_ptr<Machine>(new Interpreter<Chip48Quirks>());
+			case Profile::SuperChip:
+				return std::unique_ptr<Machine>(new Interpreter<SuperChipQuirks>());
+			case Profile::XoChip:
+				return std::unique_ptr<Machine>(new Interpreter<XoChipQuirks>());
+			case Profile::CosmacVip:
+			default:
+				return std::unique_ptr<Machine>(new Interpreter<CosmacVipQuirks>());
+		}
+	}
+
+	bool Machine::loadGame(std::string filePath)
+	{
+		File file = File(filePath);
+		if(!file.open())
+		{
+			Console::Print("Failed to open " + filePath + "!");
+			return false;
+		}
+
+		std::vector<unsigned char> data((size_t)file.size());
+		file.readAll((char*)data.data());
+		file.close();
+
+		return loadGame(data.data(), (unsigned int)data.size());
+	}
+
+	bool Machine::loadGame(const unsigned char* data, unsigned int size)
+	{
+		if(size > memorySize - PROGRAM_START)
+		{
+			Console::Print("ROM is " + std::to_string(size) + " bytes, which does not fit in memory!");
+			return false;
+		}
+
+		std::copy(data, data + size, state.mainMem.begin() + PROGRAM_START);
+		markDirty(PROGRAM_START, size);
+
+		romSize = size;
+		romHash = Hash::Fnv1a(data, size);
+
+		return true;
+	}
+
+	bool Machine::loadAotModule(std::string filePath)
+	{
+		std::unique_ptr<AotModule> module(new AotModule());
+
+		if(!module->open(filePath))
+		{
+			return false;
+		}
+
+		const AotModuleInfo* info = module->getInfo();
+		if(info->romHash != romHash || info->profile != getProfile())
+		{
+			Console::Print("Ignoring " + filePath + ", it was translated from a different ROM or profile.");
+			return false;
+		}
+
+		aotModule = std::move(module);
+		aotRunner = info->run;
+
+		return true;
+	}
+
+	unsigned long long Machine::getRomHash() const
+	{
+		return romHash;
+	}
+
+	unsigned int Machine::getRomSize() const
+	{
+		return romSize;
+	}
+
+	void Machine::setKey(unsigned char key, bool pressed)
+	{
+		state.keys[key & 0xF] = pressed;
+	}
+
+	void Machine::setKeys(uint16_t keys)
+	{
+		for(unsigned char key = 0; key < 16; key++)
+		{
+			state.keys[key] = (keys >> key) & 1;
+		}
+	}
+
+	uint16_t Machine::takeKeysPolled()
+	{
+		//The keys Ex9E/ExA1 looked at since the last call, the frontend uses it to see when a key event got noticed.
+		uint16_t keys = state.keysPolled;
+		state.keysPolled = 0;
+		return keys;
+	}
+
+	bool Machine::isWaitingForKey() const
+	{
+		return state.waitingForKey;
+	}
+
+	void Machine::provideKey(unsigned char key)
+	{
+		if(state.waitingForKey)
+		{
+			state.vReg[state.keyRegister] = (unsigned char)(key & 0xF);
+			state.waitingForKey = false;
+		}
+	}
+
+	bool Machine::isHalted() const
+	{
+		return state.halted;
+	}
+
+	unsigned int Machine::getCyclesPerFrame() const
+	{
+		return cyclesPerFrame;
+	}
+
+	void Machine::setCyclesPerFrame(unsigned int cyclesPerFrame)
+	{
+		this->cyclesPerFrame = cyclesPerFrame;
+	}
+
+	void Machine::setRandomSeed(uint32_t seed)
+	{
+		//Same rules as seeding std::minstd_rand, zero would get the generator stuck.
+		state.randomState = seed % 2147483647u == 0 ? 1u : seed % 2147483647u;
+	}
+
+	void Machine::setCoverageMap(unsigned char* coverageMap, unsigned int size)
+	{
+		//size has to be a power of two, the program counter is masked down to an index.
+		this->coverageMap = coverageMap;
+		coverageMask = size - 1;
+	}
+
+	void Machine::setDebugger(Debugger* debugger)
+	{
+		this->debugger = debugger;
+	}
+
+	void Machine::saveState(MachineState& snapshot)
+	{
+		snapshot = state;
+		dirtyPages.fill(0);
+	}
+
+	void Machine::restoreState(const MachineState& snapshot)
+	{
+		state = snapshot;
+		dirtyPages.fill(0);
+		forgetRunState();
+	}
+
+	void Machine::resetTo(const MachineState& snapshot)
+	{
+		//Only valid for the snapshot that was last saved or restored. Since then memory can only have changed in the
+		//pages marked dirty, so those are the only ones copied back. Everything after mainMem is small and is
+		//copied wholesale.
+		static_assert(std::is_trivially_copyable<MachineState>::value, "MachineState has to be trivially copyable");
+		static_assert(offsetof(MachineState, mainMem) == 0, "mainMem has to be the first member of MachineState");
+
+		for(unsigned int word = 0; word < dirtyPages.size(); word++)
+		{
+			for(unsigned int bit = 0; dirtyPages[word] >> bit != 0; bit++)
+			{
+				if(dirtyPages[word] & ((uint64_t)1 << bit))
+				{
+					unsigned int page = word * 64 + bit;
+					std::memcpy(&state.mainMem[page * PAGE_SIZE], &snapshot.mainMem[page * PAGE_SIZE], PAGE_SIZE);
+				}
+			}
+		}
+		dirtyPages.fill(0);
+
+		const size_t registersOffset = sizeof(state.mainMem);
+		std::memcpy((unsigned char*)&state + registersOffset, (const unsigned char*)&snapshot + registersOffset, sizeof(MachineState) - registersOffset);
+		forgetRunState();
+	}
+
+	void Machine::forgetRunState()
+	{
+		//What the machine learned while running lives outside MachineState. Going back to a snapshot forgets it, so
+		//a run from a snapshot behaves the same whatever ran before, which the fuzzer's coverage relies on.
+		frameCyclesLeft = 0;
+		idleLoopCount = 0;
+	}
+
+	const MachineState& Machine::getState() const
+	{
+		return state;
+	}
+
+	const MachineStats& Machine::getStats() const
+	{
+		return stats;
+	}
+
+	unsigned int Machine::getIdleLoopCount() const
+	{
+		return idleLoopCount;
+	}
+
+	unsigned short Machine::getIdleLoop(unsigned int index) const
+	{
+		return idleLoops[index];
+	}
+
+	void Machine::setIdleLoops(const unsigned short* addresses, unsigned int count)
+	{
+		idleLoopCount = 0;
+		for(unsigned int i = 0; i < count; i++)
+		{
+			noteIdleLoop(addresses[i]);
+		}
+	}
+
+	void Machine::loadFontData()
+	{
+		std::array<unsigned char, 80> fontData =
+				{
+						0xF0, 0x90, 0x90, 0x90, 0xF0, //0
+						0x20, 0x60, 0x20, 0x20, 0x70, //1
+						0xF0, 0x10, 0xF0, 0x80, 0xF0, //2
+						0xF0, 0x10, 0xF0, 0x10, 0xF0, //3
+						0x90, 0x90, 0xF0, 0x10, 0x10, //4
+						0xF0, 0x80, 0xF0, 0x10, 0xF0, //5
+						0xF0, 0x80, 0xF0, 0x90, 0xF0, //6
+						0xF0, 0x10, 0x20, 0x40, 0x40, //7
+						0xF0, 0x90, 0xF0, 0x90, 0xF0, //8
+						0xF0, 0x90, 0xF0, 0x10, 0xF0, //9
+						0xF0, 0x90, 0xF0, 0x90, 0x90, //A
+						0xE0, 0x90, 0xE0, 0x90, 0xE0, //B
+						0xF0, 0x80, 0x80, 0x80, 0xF0, //C
+						0xE0, 0x90, 0x90, 0x90, 0xE0, //D
+						0xF0, 0x80, 0xF0, 0x80, 0xF0, //E
+						0xF0, 0x80, 0xF0, 0x80, 0x80 //F
+				};
+
+		std::array<unsigned char, 160> bigFontData =
+				{
+						0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, //0
+						0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, //1
+						0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, //2
+						0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, //3
+						0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, //4
+						0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, //5
+						0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, //6
+						0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, //7
+						0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, //8
+						0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, //9
+						0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, //A
+						0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, //B
+						0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C, //C
+						0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, //D
+						0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, //E
+						0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0 //F
+				};
+
+		std::copy(std::begin(fontData), std::end(fontData), std::begin(state.mainMem));
+		std::copy(std::begin(bigFontData), std::end(bigFontData), std::begin(state.mainMem) + BIG_FONT_ADDRESS);
+	}
+
+	void Machine::noteStore(unsigned short address, unsigned int length)
+	{
+		markDirty(address, length);
+
+		//Translated blocks go stale once the program writes over them, from then on only the interpreter runs.
+		if(aotModule != nullptr && !state.codeModified && aotModule->containsCode(address, length))
+		{
+			state.codeModified = true;
+			Console::Print("Program modified its translated code, falling back to the interpreter.");
+		}
+	}
+
+	void Machine::markDirty(unsigned int address, unsigned int length)
+	{
+		//Stores wrap at the end of memory, so a range can cover the last page and the first one.
+		for(unsigned int page = address / PAGE_SIZE, last = (address + length - 1) / PAGE_SIZE; length > 0 && page <= last; page++)
+		{
+			unsigned int wrapped = page % (memorySize / PAGE_SIZE);
+			dirtyPages[wrapped / 64] |= (uint64_t)1 << (wrapped % 64);
+		}
+	}
+
+	void Machine::noteIdleLoop(unsigned short address)
+	{
+		if(!isIdleLoop(address) && idleLoopCount < idleLoops.size())
+		{
+			idleLoops[idleLoopCount++] = address;
+		}
+	}
+
+	bool Machine::isIdleLoop(unsigned short address) const
+	{
+		for(unsigned int i = 0; i < idleLoopCount; i++)
+		{
+			if(idleLoops[i] == address)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Machine::tickTimers()
+	{
+		//The timers tick once per frame, whether or not the interpreter is waiting on a key press.
+		if(state.delayRegister > 0)
+		{
+			state.delayRegister--;
+		}
+		if(state.soundRegister > 0)
+		{
+			state.soundRegister--;
+			Console::Print("Beep!");
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef EMU_8_MACHINE_H
+#define EMU_8_MACHINE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "AotAbi.h"
+#include "MachineState.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	class AotModule;
+	class Debugger;
+
+	struct MachineStats
+	{
+		unsigned long long instructionsExecuted;
+		unsigned long long instructionsSkipped;
+	};
+
+	class Machine
+	{
+	protected:
+		MachineState state;
+		MachineStats stats;
+		unsigned int cyclesPerFrame;
+		unsigned int memorySize;
+		unsigned char* coverageMap;
+		unsigned int coverageMask;
+		std::array<uint64_t, 4> dirtyPages;
+		unsigned long long romHash;
+		unsigned int romSize;
+		std::unique_ptr<AotModule> aotModule;
+		AotContext aotContext;
+		AotRunner aotRunner;
+		Debugger* debugger;
+		unsigned int frameCyclesLeft; //Cycles still to run in a frame the debugger paused part way through.
+		std::array<unsigned short, 16> idleLoops; //Start of each idle loop skipped since the last restore, or set from the analysis cache.
+		unsigned int idleLoopCount;
+
+		Machine();
+		void loadFontData();
+		void tickTimers();
+		void noteStore(unsigned short address, unsigned int length);
+		void markDirty(unsigned int address, unsigned int length);
+		void noteIdleLoop(unsigned short address);
+		bool isIdleLoop(unsigned short address) const;
+		void forgetRunState();
+
+	public:
+		static const unsigned short PROGRAM_START = 512;
+		static const unsigned short BIG_FONT_ADDRESS = 80;
+		static const unsigned int DEFAULT_CYCLES_PER_FRAME = 16;
+		static const unsigned int PAGE_SIZE = 256;
+
+		static std::unique_ptr<Machine> Create(Profile profile);
+
+		virtual ~Machine();
+		virtual Profile getProfile() const = 0;
+		virtual void runFrame() = 0;
+		bool loadGame(std::string filePath);
+		bool loadGame(const unsigned char* data, unsigned int size);
+		bool loadAotModule(std::string filePath);
+		unsigned long long getRomHash() const;
+		unsigned int getRomSize() const;
+		void setKey(unsigned char key, bool pressed);
+		void setKeys(uint16_t keys);
+		uint16_t takeKeysPolled();
+		bool isWaitingForKey() const;
+		void provideKey(unsigned char key);
+		bool isHalted() const;
+		unsigned int getCyclesPerFrame() const;
+		void setCyclesPerFrame(unsigned int cyclesPerFrame);
+		void setRandomSeed(uint32_t seed);
+		void setCoverageMap(unsigned char* coverageMap, unsigned int size);
+		void setDebugger(Debugger* debugger);
+		void saveState(MachineState& snapshot);
+		void restoreState(const MachineState& snapshot);
+		void resetTo(const MachineState& snapshot);
+		const MachineState& getState() const;
+		const MachineStats& getStats() const;
+		unsigned int getIdleLoopCount() const;
+		unsigned short getIdleLoop(unsigned int index) const;
+		void setIdleLoops(const unsigned short* addresses, unsigned int count);
+	};
+}
+
+#endif //EMU_8_MACHINE_H
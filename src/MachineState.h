@@ -0,0 +1,37 @@
+#ifndef EMU_8_MACHINESTATE_H
+#define EMU_8_MACHINESTATE_H
+
+#include <array>
+#include <cstdint>
+#include "Framebuffer.h"
+
+namespace Emu8
+{
+	//Everything a running program can observe. Kept free of any frontend state and trivially copyable, so a snapshot
+	//is a plain copy. mainMem has to stay the first member, see Machine::resetTo.
+	struct MachineState
+	{
+		std::array<unsigned char, 65536> mainMem;
+		std::array<unsigned short, 16> stackMem;
+		std::array<unsigned char, 16> vReg;
+		std::array<unsigned char, 16> rplFlags;
+		std::array<bool, 16> keys;
+		std::array<unsigned char, 16> audioPattern;
+		Framebuffer framebuffer;
+		uint32_t randomState; //Cxkk draws from a minstd_rand sequence, kept here so a seed can be replayed.
+		uint16_t keysPolled; //Keys Ex9E/ExA1 looked at since the frontend last collected them, for input latency.
+		unsigned short iRegister;
+		unsigned short programCounter;
+		unsigned char stackPointer;
+		unsigned char delayRegister;
+		unsigned char soundRegister;
+		unsigned char planeMask;
+		unsigned char audioPitch;
+		unsigned char keyRegister;
+		bool waitingForKey;
+		bool halted;
+		bool codeModified; //The program wrote over code that was translated ahead of time.
+	};
+}
+
+#endif //EMU_8_MACHINESTATE_H
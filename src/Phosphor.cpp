@@ -0,0 +1,172 @@
+#include "Phosphor.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EMU_8_PHOSPHOR_SSE2
+#endif
+
+namespace Emu8
+{
+	Phosphor::Phosphor()
+			: output(), target(), hiResBlocks(), loResBlocks(), lastRows(), rowFading(), rowDirty(), palette(), decayStep(255), lastHiRes(false), hasFrame(false), rowsBlended(0), lastCost(0)
+	{
+		setPalette({0x000000, 0xFFFFFF, 0xAAAAAA, 0xFF0000});
+	}
+
+	void Phosphor::setPalette(const std::array<uint32_t, 4>& palette)
+	{
+		this->palette = palette;
+
+		//Expand the palette into every block of four pixels a row can hold, plane 0 bits low and plane 1 bits high.
+		for(unsigned int index = 0; index < hiResBlocks.size(); index++)
+		{
+			for(unsigned int pixel = 0; pixel < 4; pixel++)
+			{
+				unsigned int shift = 3 - pixel;
+				hiResBlocks[index][pixel] = palette[((index >> shift) & 1) | (((index >> (4 + shift)) & 1) << 1)];
+			}
+		}
+		for(unsigned int index = 0; index < loResBlocks.size(); index++)
+		{
+			for(unsigned int pixel = 0; pixel < 4; pixel++)
+			{
+				unsigned int shift = 1 - pixel / 2;
+				loResBlocks[index][pixel] = palette[((index >> shift) & 1) | (((index >> (2 + shift)) & 1) << 1)];
+			}
+		}
+
+		reset();
+	}
+
+	void Phosphor::setDecayFrames(unsigned int frames)
+	{
+		//One frame or none means no persistence at all, a pixel goes out as soon as it is erased.
+		decayStep = (uint8_t)(frames <= 1 ? 255 : (255 + frames - 1) / frames);
+	}
+
+	void Phosphor::reset()
+	{
+		hasFrame = false;
+		output.fill(palette[0]);
+		rowFading.fill(false);
+		rowDirty.fill(true);
+	}
+
+	void Phosphor::compose(const Framebuffer& framebuffer)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		//A change of resolution moves every pixel, so everything is rebuilt.
+		bool rebuild = !hasFrame || framebuffer.isHiRes() != lastHiRes;
+		unsigned int scale = WIDTH / framebuffer.getWidth();
+		hasFrame = true;
+		lastHiRes = framebuffer.isHiRes();
+		rowsBlended = 0;
+
+		for(unsigned int y = 0; y < HEIGHT; y++)
+		{
+			uint64_t* last = &lastRows[y * Framebuffer::PLANE_COUNT * Framebuffer::WORDS_PER_ROW];
+			bool changed = rebuild;
+			for(unsigned int plane = 0; plane < Framebuffer::PLANE_COUNT; plane++)
+			{
+				const uint64_t* row = framebuffer.getRow(plane, y / scale);
+				uint64_t* lastPlane = last + plane * Framebuffer::WORDS_PER_ROW;
+				for(unsigned int word = 0; word < Framebuffer::WORDS_PER_ROW; word++)
+				{
+					changed |= lastPlane[word] != row[word];
+					lastPlane[word] = row[word];
+				}
+			}
+
+			if(changed)
+			{
+				buildTargetRow(framebuffer, y);
+			}
+
+			rowDirty[y] = changed || rowFading[y];
+			if(rowDirty[y])
+			{
+				rowFading[y] = blendRow(y);
+				rowsBlended++;
+			}
+		}
+
+		lastCost = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Phosphor::buildTargetRow(const Framebuffer& framebuffer, unsigned int y)
+	{
+		//Four output pixels come from four bits of each plane in high resolution and from two, doubled, in low
+		//resolution. Either way the pixels are one lookup in the expanded palette away.
+		const unsigned int bitsPerBlock = framebuffer.isHiRes() ? 4 : 2;
+		const unsigned int scale = WIDTH / framebuffer.getWidth();
+		const std::array<uint32_t, 4>* blocks = framebuffer.isHiRes() ? hiResBlocks.data() : loResBlocks.data();
+		const uint64_t* plane0 = framebuffer.getRow(0, y / scale);
+		const uint64_t* plane1 = framebuffer.getRow(1, y / scale);
+		uint32_t* row = &target[y * WIDTH];
+
+		for(unsigned int x = 0; x < WIDTH; x += 4)
+		{
+			unsigned int column = x / scale;
+			unsigned int shift = 64 - bitsPerBlock - column % 64;
+			unsigned int mask = (1 << bitsPerBlock) - 1;
+			unsigned int index = (unsigned int)((plane0[column / 64] >> shift) & mask) | (unsigned int)(((plane1[column / 64] >> shift) & mask) << bitsPerBlock);
+			std::memcpy(row + x, blocks[index].data(), sizeof(blocks[index]));
+		}
+	}
+
+	bool Phosphor::blendRow(unsigned int y)
+	{
+		//out = max(out - step, target) on every byte, saturating. Returns whether anything is still fading.
+		uint32_t* out = &output[y * WIDTH];
+		const uint32_t* in = &target[y * WIDTH];
+
+#ifdef EMU_8_PHOSPHOR_SSE2
+		__m128i step = _mm_set1_epi8((char)decayStep);
+		__m128i settled = _mm_set1_epi8((char)0xFF);
+		for(unsigned int x = 0; x < WIDTH; x += 4)
+		{
+			__m128i faded = _mm_subs_epu8(_mm_load_si128((const __m128i*)(out + x)), step);
+			__m128i wanted = _mm_load_si128((const __m128i*)(in + x));
+			__m128i blended = _mm_max_epu8(faded, wanted);
+			_mm_store_si128((__m128i*)(out + x), blended);
+			settled = _mm_and_si128(settled, _mm_cmpeq_epi8(blended, wanted));
+		}
+		return _mm_movemask_epi8(settled) != 0xFFFF;
+#else
+		bool fading = false;
+		unsigned char* outBytes = (unsigned char*)out;
+		const unsigned char* inBytes = (const unsigned char*)in;
+		for(unsigned int i = 0; i < WIDTH * sizeof(uint32_t); i++)
+		{
+			unsigned char faded = outBytes[i] > decayStep ? outBytes[i] - decayStep : 0;
+			outBytes[i] = std::max(faded, inBytes[i]);
+			fading |= outBytes[i] != inBytes[i];
+		}
+		return fading;
+#endif
+	}
+
+	const uint32_t* Phosphor::getRow(unsigned int y) const
+	{
+		return &output[y * WIDTH];
+	}
+
+	bool Phosphor::isRowDirty(unsigned int y) const
+	{
+		return rowDirty[y];
+	}
+
+	unsigned int Phosphor::getRowsBlended() const
+	{
+		return rowsBlended;
+	}
+
+	double Phosphor::getLastCost() const
+	{
+		return lastCost;
+	}
+}
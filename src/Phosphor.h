@@ -0,0 +1,53 @@
+#ifndef EMU_8_PHOSPHOR_H
+#define EMU_8_PHOSPHOR_H
+
+#include <array>
+#include <cstdint>
+#include "Framebuffer.h"
+
+namespace Emu8
+{
+	//Fakes the persistence of a CRT phosphor so sprites that are erased and redrawn every frame stop flickering. Every
+	//pixel lights up at once to its palette colour and fades by an equal step per frame over the decay frames, each
+	//byte of the 32 bit colour on its own, so the palette may be in whatever channel order the caller draws with.
+	//
+	//Only rows whose framebuffer words changed or that are still fading are blended, a still screen costs nothing
+	//but the row comparisons.
+	class Phosphor
+	{
+	public:
+		static const unsigned int WIDTH = Framebuffer::MAX_WIDTH;
+		static const unsigned int HEIGHT = Framebuffer::MAX_HEIGHT;
+
+	private:
+		alignas(16) std::array<uint32_t, WIDTH * HEIGHT> output;
+		alignas(16) std::array<uint32_t, WIDTH * HEIGHT> target;
+		std::array<std::array<uint32_t, 4>, 256> hiResBlocks;
+		std::array<std::array<uint32_t, 4>, 16> loResBlocks;
+		std::array<uint64_t, HEIGHT * Framebuffer::PLANE_COUNT * Framebuffer::WORDS_PER_ROW> lastRows;
+		std::array<bool, HEIGHT> rowFading;
+		std::array<bool, HEIGHT> rowDirty;
+		std::array<uint32_t, 4> palette;
+		uint8_t decayStep;
+		bool lastHiRes;
+		bool hasFrame;
+		unsigned int rowsBlended;
+		double lastCost;
+
+		void buildTargetRow(const Framebuffer& framebuffer, unsigned int y);
+		bool blendRow(unsigned int y);
+
+	public:
+		Phosphor();
+		void setPalette(const std::array<uint32_t, 4>& palette);
+		void setDecayFrames(unsigned int frames);
+		void reset();
+		void compose(const Framebuffer& framebuffer);
+		const uint32_t* getRow(unsigned int y) const;
+		bool isRowDirty(unsigned int y) const;
+		unsigned int getRowsBlended() const;
+		double getLastCost() const;
+	};
+}
+
+#endif //EMU_8_PHOSPHOR_H
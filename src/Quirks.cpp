@@ -0,0 +1,75 @@
+#include "Quirks.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+namespace Emu8
+{
+	bool Profiles::Parse(std::string name, Profile& profile)
+	{
+		std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+		if(name == "vip" || name == "cosmac-vip" || name == "chip8" || name == "chip-8")
+		{
+			profile = Profile::CosmacVip;
+		}
+		else if(name == "chip48" || name == "chip-48")
+		{
+			profile = Profile::Chip48;
+		}
+		else if(name == "schip" || name == "superchip" || name == "super-chip")
+		{
+			profile = Profile::SuperChip;
+		}
+		else if(name == "xochip" || name == "xo-chip")
+		{
+			profile = Profile::XoChip;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	Profile Profiles::FromFileName(std::string filePath)
+	{
+		//Follow the extensions the ROM archives use, anything else is treated as a plain CHIP-8 program.
+		std::string::size_type dot = filePath.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : filePath.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if(extension == "c48")
+		{
+			return Profile::Chip48;
+		}
+		if(extension == "sc8")
+		{
+			return Profile::SuperChip;
+		}
+		if(extension == "xo8")
+		{
+			return Profile::XoChip;
+		}
+
+		return Profile::CosmacVip;
+	}
+
+	std::string Profiles::GetName(Profile profile)
+	{
+		switch(profile)
+		{
+			case Profile::CosmacVip:
+				return "cosmac-vip";
+			case Profile::Chip48:
+				return "chip-48";
+			case Profile::SuperChip:
+				return "schip";
+			case Profile::XoChip:
+				return "xo-chip";
+			default:
+				return "unknown";
+		}
+	}
+}
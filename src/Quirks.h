@@ -0,0 +1,87 @@
+#ifndef EMU_8_QUIRKS_H
+#define EMU_8_QUIRKS_H
+
+#include <string>
+
+namespace Emu8
+{
+	enum class Profile
+	{
+		CosmacVip,
+		Chip48,
+		SuperChip,
+		XoChip
+	};
+
+	//How far Fx55/Fx65 move I after touching V0 through Vx.
+	enum class IndexIncrement
+	{
+		None,
+		ByX,
+		ByXPlusOne
+	};
+
+	//Quirk policies. The interpreter is instantiated once per policy, so every quirk below is a compile time
+	//constant and the branches on it are folded away.
+	struct CosmacVipQuirks
+	{
+		static constexpr Profile profile = Profile::CosmacVip;
+		static constexpr bool shiftUsesVy = true; //8xy6/8xyE shift Vy into Vx instead of shifting Vx in place
+		static constexpr IndexIncrement loadStoreIncrement = IndexIncrement::ByXPlusOne;
+		static constexpr bool jumpUsesVx = false; //Bxnn jumps to xnn + Vx instead of Bnnn jumping to nnn + V0
+		static constexpr bool spritesWrap = false; //Sprite pixels past the screen edges wrap instead of clipping
+		static constexpr bool logicResetsVf = true; //8xy1/8xy2/8xy3 set VF = 0
+		static constexpr bool superChipInstructions = false;
+		static constexpr bool xoChipInstructions = false;
+		static constexpr unsigned int memorySize = 4096; //A power of two, addresses wrap around at it
+	};
+
+	struct Chip48Quirks
+	{
+		static constexpr Profile profile = Profile::Chip48;
+		static constexpr bool shiftUsesVy = false;
+		static constexpr IndexIncrement loadStoreIncrement = IndexIncrement::ByX;
+		static constexpr bool jumpUsesVx = true;
+		static constexpr bool spritesWrap = false;
+		static constexpr bool logicResetsVf = false;
+		static constexpr bool superChipInstructions = false;
+		static constexpr bool xoChipInstructions = false;
+		static constexpr unsigned int memorySize = 4096;
+	};
+
+	struct SuperChipQuirks
+	{
+		static constexpr Profile profile = Profile::SuperChip;
+		static constexpr bool shiftUsesVy = false;
+		static constexpr IndexIncrement loadStoreIncrement = IndexIncrement::None;
+		static constexpr bool jumpUsesVx = true;
+		static constexpr bool spritesWrap = false;
+		static constexpr bool logicResetsVf = false;
+		static constexpr bool superChipInstructions = true;
+		static constexpr bool xoChipInstructions = false;
+		static constexpr unsigned int memorySize = 4096;
+	};
+
+	struct XoChipQuirks
+	{
+		static constexpr Profile profile = Profile::XoChip;
+		static constexpr bool shiftUsesVy = true;
+		static constexpr IndexIncrement loadStoreIncrement = IndexIncrement::ByXPlusOne;
+		static constexpr bool jumpUsesVx = false;
+		static constexpr bool spritesWrap = true;
+		static constexpr bool logicResetsVf = false;
+		static constexpr bool superChipInstructions = true;
+		static constexpr bool xoChipInstructions = true;
+		static constexpr unsigned int memorySize = 65536;
+	};
+
+	class Profiles
+	{
+	public:
+		static bool Parse(std::string name, Profile& profile);
+		static Profile FromFileName(std::string filePath);
+		static std::string GetName(Profile profile);
+	};
+}
+
+#endif //EMU_8_QUIRKS_H
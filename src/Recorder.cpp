@@ -0,0 +1,280 @@
+#include "Recorder.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "Console.h"
+
+namespace Emu8
+{
+	const unsigned int Recorder::QUEUE_LENGTH;
+	const unsigned int Recorder::WAKE_BATCH;
+	const unsigned int Recorder::WAKE_INTERVAL_MS;
+
+	namespace
+	{
+		void AppendU32(std::vector<unsigned char>& out, uint32_t value)
+		{
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				out.push_back((unsigned char)(value >> (i * 8)));
+			}
+		}
+	}
+
+	bool Recorder::FormatFromFileName(std::string filePath, RecordingFormat& format)
+	{
+		std::string::size_type dot = filePath.find_last_of('.');
+		std::string extension = dot == std::string::npos ? "" : filePath.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+		if(extension == "y4m")
+		{
+			format = RecordingFormat::Y4m;
+		}
+		else if(extension == "raw")
+		{
+			format = RecordingFormat::Raw;
+		}
+		else if(extension == "e8rl")
+		{
+			format = RecordingFormat::RunLength;
+		}
+		else
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	Recorder::Recorder()
+			: file(), format(RecordingFormat::Raw), width(), height(), queue(QUEUE_LENGTH), queueHead(0), queueTail(0), workerSleeping(false), closing(false), wakeMutex(), wake(), worker(), pendingRepeats(0), hasPendingFrame(false), framesAdded(0), framesDropped(0), encoded()
+	{
+	}
+
+	Recorder::~Recorder()
+	{
+		close();
+	}
+
+	bool Recorder::open(std::string filePath, RecordingFormat format, unsigned int width, unsigned int height, unsigned int fps)
+	{
+		close();
+
+		file.open(filePath, std::ios::binary | std::ios::trunc);
+		if(!file)
+		{
+			Console::Print("Failed to open " + filePath + " for recording!");
+			return false;
+		}
+
+		this->format = format;
+		this->width = std::max(1u, std::min(width, (unsigned int)Framebuffer::MAX_WIDTH));
+		this->height = std::max(1u, std::min(height, (unsigned int)Framebuffer::MAX_HEIGHT));
+		queueHead = 0;
+		queueTail = 0;
+		closing = false;
+		hasPendingFrame = false;
+		framesAdded = 0;
+		framesDropped = 0;
+
+		if(format == RecordingFormat::Y4m)
+		{
+			file << "YUV4MPEG2 W" << this->width << " H" << this->height << " F" << fps << ":1 Ip A1:1 Cmono\n";
+		}
+		else if(format == RecordingFormat::RunLength)
+		{
+			const unsigned char header[6] = {'E', '8', 'R', 'L', 1, (unsigned char)fps};
+			file.write((const char*)header, sizeof(header));
+		}
+
+		worker = std::thread(&Recorder::workerLoop, this);
+		return true;
+	}
+
+	void Recorder::addFrame(const Framebuffer& framebuffer)
+	{
+		//Runs on the emulation thread every frame, so an unchanged frame costs one comparison and nothing more.
+		framesAdded++;
+		Entry& pending = queue[queueTail.load(std::memory_order_relaxed) % QUEUE_LENGTH];
+
+		if(hasPendingFrame && framebuffer == pending.frame)
+		{
+			pendingRepeats++;
+			return;
+		}
+
+		if(hasPendingFrame && !publishPendingFrame(true))
+		{
+			framesDropped++;
+			pendingRepeats++;
+			return;
+		}
+
+		queue[queueTail.load(std::memory_order_relaxed) % QUEUE_LENGTH].frame = framebuffer;
+		pendingRepeats = 1;
+		hasPendingFrame = true;
+	}
+
+	void Recorder::close()
+	{
+		if(!worker.joinable())
+		{
+			return;
+		}
+
+		if(hasPendingFrame)
+		{
+			publishPendingFrame(false);
+			hasPendingFrame = false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			closing = true;
+		}
+		wake.notify_one();
+		worker.join();
+		file.close();
+
+		if(framesDropped > 0)
+		{
+			Console::Print("Recording fell behind and dropped " + std::to_string(framesDropped) + " frames.");
+		}
+	}
+
+	bool Recorder::isOpen() const
+	{
+		return worker.joinable();
+	}
+
+	unsigned long long Recorder::getFramesAdded() const
+	{
+		return framesAdded;
+	}
+
+	unsigned long long Recorder::getFramesDropped() const
+	{
+		return framesDropped;
+	}
+
+	bool Recorder::publishPendingFrame(bool needsNextSlot)
+	{
+		//The slots from the head up to the tail belong to the worker, the one at the tail is the pending frame's.
+		unsigned int tail = queueTail.load(std::memory_order_relaxed);
+		unsigned int queued = tail - queueHead.load(std::memory_order_acquire);
+
+		if(needsNextSlot && queued + 1 >= QUEUE_LENGTH)
+		{
+			return false;
+		}
+
+		queue[tail % QUEUE_LENGTH].repeats = pendingRepeats;
+		queueTail.store(tail + 1, std::memory_order_seq_cst);
+
+		//Waking the worker for every frame would cost more than encoding it, so it is left to collect a batch.
+		//The worker announces it is going to sleep before checking the queue one last time, and the tail is
+		//published before this check, so a full batch is never missed.
+		if(queued + 1 >= WAKE_BATCH && workerSleeping.load(std::memory_order_seq_cst))
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			wake.notify_one();
+		}
+		return true;
+	}
+
+	void Recorder::workerLoop()
+	{
+		unsigned int head = queueHead.load(std::memory_order_relaxed);
+
+		while(true)
+		{
+			if(head == queueTail.load(std::memory_order_acquire))
+			{
+				std::unique_lock<std::mutex> lock(wakeMutex);
+				workerSleeping.store(true, std::memory_order_seq_cst);
+				wake.wait_for(lock, std::chrono::milliseconds(WAKE_INTERVAL_MS), [&]() { return queueTail.load(std::memory_order_seq_cst) - head >= WAKE_BATCH || closing; });
+				workerSleeping.store(false, std::memory_order_relaxed);
+
+				if(head == queueTail.load(std::memory_order_acquire))
+				{
+					if(closing)
+					{
+						return;
+					}
+					continue;
+				}
+			}
+
+			//The slot at the head is left alone by addFrame until it is released below.
+			writeEntry(queue[head % QUEUE_LENGTH]);
+			queueHead.store(++head, std::memory_order_release);
+		}
+	}
+
+	void Recorder::writeEntry(const Entry& entry)
+	{
+		const Framebuffer& frame = entry.frame;
+		encoded.clear();
+
+		if(format == RecordingFormat::RunLength)
+		{
+			encoded.push_back((unsigned char)frame.getWidth());
+			encoded.push_back((unsigned char)frame.getHeight());
+			AppendU32(encoded, entry.repeats);
+			AppendU32(encoded, 0);
+
+			unsigned int run = 0;
+			unsigned char value = 0;
+			for(unsigned int plane = 0; plane < Framebuffer::PLANE_COUNT; plane++)
+			{
+				for(unsigned int y = 0; y < frame.getHeight(); y++)
+				{
+					const uint64_t* row = frame.getRow(plane, y);
+					for(unsigned int byte = 0; byte < frame.getWidth() / 8; byte++)
+					{
+						unsigned char next = (unsigned char)(row[byte / 8] >> (56 - (byte % 8) * 8));
+						if(run > 0 && (next != value || run == 255))
+						{
+							encoded.push_back((unsigned char)run);
+							encoded.push_back(value);
+							run = 0;
+						}
+						value = next;
+						run++;
+					}
+				}
+			}
+			encoded.push_back((unsigned char)run);
+			encoded.push_back(value);
+
+			uint32_t length = (uint32_t)(encoded.size() - 10);
+			for(unsigned int i = 0; i < 4; i++)
+			{
+				encoded[6 + i] = (unsigned char)(length >> (i * 8));
+			}
+			file.write((const char*)encoded.data(), encoded.size());
+			return;
+		}
+
+		//Y4m and Raw have no way to say a frame repeats, so it is written out again for every frame it was shown.
+		const unsigned char luma[4] = {0, 255, 170, 76};
+		for(unsigned int y = 0; y < height; y++)
+		{
+			for(unsigned int x = 0; x < width; x++)
+			{
+				unsigned char pixel = frame.getPixel(x * frame.getWidth() / width, y * frame.getHeight() / height);
+				encoded.push_back(format == RecordingFormat::Y4m ? luma[pixel] : pixel);
+			}
+		}
+
+		for(uint32_t i = 0; i < entry.repeats; i++)
+		{
+			if(format == RecordingFormat::Y4m)
+			{
+				file.write("FRAME\n", 6);
+			}
+			file.write((const char*)encoded.data(), encoded.size());
+		}
+	}
+}
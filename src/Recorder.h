@@ -0,0 +1,86 @@
+#ifndef EMU_8_RECORDER_H
+#define EMU_8_RECORDER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Framebuffer.h"
+
+namespace Emu8
+{
+	enum class RecordingFormat
+	{
+		Y4m, //Greyscale YUV4MPEG2, which ffmpeg and most players read.
+		Raw, //One byte per pixel holding its plane bits, frames back to back.
+		RunLength //The compact format below.
+	};
+
+	//Records the framebuffer once per frame. addFrame only compares the frame against the previous one and, if it
+	//changed, copies it into a bounded single producer queue. A worker thread, woken once per batch of frames, does
+	//the encoding and the file writes. If the worker falls so far behind that the queue is full, the frame is counted
+	//as dropped and the previous frame is shown for longer instead, so the recording keeps the right length.
+	//
+	//Y4m and Raw have a fixed size given to open, low resolution frames are doubled to fill 128x64. RunLength
+	//stores every frame at its own resolution:
+	//
+	//    "E8RL", u8 version, u8 fps, then per distinct frame:
+	//    u8 width, u8 height, u32 frames shown, u32 encoded length,
+	//    (u8 run, u8 value) pairs covering the planes' packed rows, width / 8 bytes per row, plane 0 first.
+	//
+	//Numbers are little endian.
+	class Recorder
+	{
+	public:
+		static const unsigned int QUEUE_LENGTH = 256;
+		static const unsigned int WAKE_BATCH = 32;
+		static const unsigned int WAKE_INTERVAL_MS = 100;
+
+	private:
+		struct Entry
+		{
+			Framebuffer frame;
+			uint32_t repeats;
+		};
+
+		std::ofstream file;
+		RecordingFormat format;
+		unsigned int width;
+		unsigned int height;
+		std::vector<Entry> queue;
+		std::atomic<unsigned int> queueHead; //Only the worker moves the head and only addFrame moves the tail, so
+		std::atomic<unsigned int> queueTail; //neither side takes a lock in the common case.
+		std::atomic<bool> workerSleeping;
+		bool closing; //Guarded by wakeMutex.
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		std::thread worker;
+		uint32_t pendingRepeats; //The slot at the tail holds the last frame until it changes and the slot is published.
+		bool hasPendingFrame;
+		unsigned long long framesAdded;
+		unsigned long long framesDropped;
+		std::vector<unsigned char> encoded;
+
+		void workerLoop();
+		bool publishPendingFrame(bool needsNextSlot);
+		void writeEntry(const Entry& entry);
+
+	public:
+		static bool FormatFromFileName(std::string filePath, RecordingFormat& format);
+
+		Recorder();
+		~Recorder();
+		bool open(std::string filePath, RecordingFormat format, unsigned int width, unsigned int height, unsigned int fps);
+		void addFrame(const Framebuffer& framebuffer);
+		void close();
+		bool isOpen() const;
+		unsigned long long getFramesAdded() const;
+		unsigned long long getFramesDropped() const;
+	};
+}
+
+#endif //EMU_8_RECORDER_H
@@ -0,0 +1,174 @@
+#include "Rollback.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include "Machine.h"
+#include "Transport.h"
+
+namespace Emu8
+{
+	namespace
+	{
+		struct KeysPacket
+		{
+			static const uint32_t MAGIC = 0x4B385545; //"EU8K"
+
+			uint32_t magic;
+			uint32_t firstFrame;
+			uint32_t acknowledgedFrame; //The sender has the receiver's keys for every frame before this.
+			uint32_t count;
+			uint16_t keys[Rollback::INPUT_WINDOW];
+		};
+
+		const unsigned int HEADER_SIZE = offsetof(KeysPacket, keys);
+	}
+
+	const unsigned int Rollback::MAX_ROLLBACK;
+	const unsigned int Rollback::INPUT_WINDOW;
+	const unsigned int Rollback::HISTORY_LENGTH;
+
+	Rollback::Rollback(Machine& machine, Transport& transport, unsigned int maxRollback)
+			: machine(machine), transport(transport), maxRollback(std::max(1u, std::min(maxRollback, MAX_ROLLBACK))), states(), localKeys(), remoteKeys(), frame(0), remoteFrame(0), acknowledgedFrame(0), stats()
+	{
+		states.resize(this->maxRollback + 1);
+	}
+
+	bool Rollback::advance(uint16_t keys)
+	{
+		unsigned long long rollbackFrom = frame;
+		receivePackets(rollbackFrom);
+
+		if(rollbackFrom < frame)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			machine.restoreState(states[rollbackFrom % states.size()]);
+			for(unsigned long long index = rollbackFrom; index < frame; index++)
+			{
+				runFrame(index);
+			}
+
+			stats.lastResimulationTime = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			stats.resimulationTime += stats.lastResimulationTime;
+			stats.framesResimulated += frame - rollbackFrom;
+			stats.rollbacks++;
+		}
+
+		//Too far ahead of the other peer to be able to undo a wrong guess, wait for it. The keys are still sent, it
+		//may be the one waiting on them.
+		if(frame >= remoteFrame + maxRollback)
+		{
+			stats.stalls++;
+			sendPacket();
+			return false;
+		}
+
+		localKeys[frame % HISTORY_LENGTH] = keys;
+		runFrame(frame);
+		frame++;
+		stats.frames++;
+
+		sendPacket();
+		return true;
+	}
+
+	void Rollback::receivePackets(unsigned long long& rollbackFrom)
+	{
+		KeysPacket packet;
+		unsigned int size = 0;
+
+		while(transport.receive(&packet, sizeof(packet), size))
+		{
+			if(size < HEADER_SIZE || packet.magic != KeysPacket::MAGIC || packet.count > INPUT_WINDOW || size < HEADER_SIZE + packet.count * sizeof(uint16_t))
+			{
+				continue;
+			}
+
+			acknowledgedFrame = std::max(acknowledgedFrame, (unsigned long long)packet.acknowledgedFrame);
+
+			//Packets overlap and may come out of order, only the keys for the next unknown frame onwards are new.
+			for(uint32_t i = 0; i < packet.count; i++)
+			{
+				unsigned long long index = (unsigned long long)packet.firstFrame + i;
+				if(index != remoteFrame)
+				{
+					continue;
+				}
+
+				uint16_t& guess = remoteKeys[index % HISTORY_LENGTH];
+				if(index < frame && guess != packet.keys[i])
+				{
+					rollbackFrom = std::min(rollbackFrom, index);
+				}
+				guess = packet.keys[i];
+				remoteFrame++;
+			}
+		}
+	}
+
+	void Rollback::sendPacket()
+	{
+		//Every key the other peer hasn't acknowledged yet goes out again, so a lost packet costs nothing but a
+		//little latency. A peer is at most maxRollback frames ahead of the keys it has, so neither side can get
+		//more than twice that ahead of what the other acknowledged.
+		KeysPacket packet;
+		unsigned long long first = std::max(acknowledgedFrame, frame - std::min(frame, (unsigned long long)INPUT_WINDOW));
+		packet.magic = KeysPacket::MAGIC;
+		packet.firstFrame = (uint32_t)first;
+		packet.acknowledgedFrame = (uint32_t)remoteFrame;
+		packet.count = (uint32_t)(frame - first);
+		for(uint32_t i = 0; i < packet.count; i++)
+		{
+			packet.keys[i] = localKeys[(first + i) % HISTORY_LENGTH];
+		}
+
+		transport.send(&packet, HEADER_SIZE + packet.count * sizeof(uint16_t));
+	}
+
+	void Rollback::runFrame(unsigned long long index)
+	{
+		//Past what is known the other peer is guessed to still hold the keys it last held.
+		if(index >= remoteFrame)
+		{
+			remoteKeys[index % HISTORY_LENGTH] = remoteFrame > 0 ? remoteKeys[(remoteFrame - 1) % HISTORY_LENGTH] : 0;
+		}
+
+		machine.saveState(states[index % states.size()]);
+
+		uint16_t keys = localKeys[index % HISTORY_LENGTH] | remoteKeys[index % HISTORY_LENGTH];
+		machine.setKeys(keys);
+
+		//Fx0A has to see the same key on both peers, so it takes the lowest key that went down this frame rather
+		//than whichever key event came first.
+		if(machine.isWaitingForKey())
+		{
+			uint16_t previous = index > 0 ? (uint16_t)(localKeys[(index - 1) % HISTORY_LENGTH] | remoteKeys[(index - 1) % HISTORY_LENGTH]) : 0;
+			uint16_t pressed = keys & ~previous;
+			for(unsigned char key = 0; key < 16; key++)
+			{
+				if(pressed & (1 << key))
+				{
+					machine.provideKey(key);
+					break;
+				}
+			}
+		}
+
+		machine.runFrame();
+	}
+
+	unsigned long long Rollback::getFrame() const
+	{
+		return frame;
+	}
+
+	unsigned long long Rollback::getRemoteFrame() const
+	{
+		return remoteFrame;
+	}
+
+	const RollbackStats& Rollback::getStats() const
+	{
+		return stats;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef EMU_8_ROLLBACK_H
+#define EMU_8_ROLLBACK_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "MachineState.h"
+
+namespace Emu8
+{
+	class Machine;
+	class Transport;
+
+	struct RollbackStats
+	{
+		unsigned long long frames;
+		unsigned long long rollbacks;
+		unsigned long long framesResimulated;
+		unsigned long long stalls; //Frames held back because the other peer fell too far behind.
+		double resimulationTime; //Microseconds spent running frames again, in total.
+		double lastResimulationTime;
+	};
+
+	//Lets two peers play on one shared keypad without waiting on each other. Every frame the local keys are sent to
+	//the other peer and the machine runs straight away, with the remote keys guessed to be whatever they were last
+	//known to be. When the real remote keys for a frame arrive and differ from the guess, the machine goes back to
+	//the state saved before that frame and runs every frame since again with the right keys, all within one call.
+	//
+	//The keypad the program sees is both peers' keys together, so both have to run the same ROM with the same profile
+	//and seed. A peer never gets more than maxRollback frames ahead of the last remote keys it has, it stalls instead,
+	//which bounds both the states kept and the frames run again after a wrong guess.
+	class Rollback
+	{
+	public:
+		static const unsigned int MAX_ROLLBACK = 30;
+		static const unsigned int INPUT_WINDOW = MAX_ROLLBACK * 2; //Keys sent again in every packet, see sendPacket.
+		static const unsigned int HISTORY_LENGTH = 64;
+
+	private:
+		Machine& machine;
+		Transport& transport;
+		unsigned int maxRollback;
+		std::vector<MachineState> states; //State before each of the last maxRollback + 1 frames.
+		std::array<uint16_t, HISTORY_LENGTH> localKeys;
+		std::array<uint16_t, HISTORY_LENGTH> remoteKeys; //Known up to remoteFrame, a guess after it.
+		unsigned long long frame; //Next frame to run.
+		unsigned long long remoteFrame; //Remote keys are known for every frame before this.
+		unsigned long long acknowledgedFrame; //The other peer has our keys for every frame before this.
+		RollbackStats stats;
+
+		void receivePackets(unsigned long long& rollbackFrom);
+		void sendPacket();
+		void runFrame(unsigned long long index);
+
+	public:
+		Rollback(Machine& machine, Transport& transport, unsigned int maxRollback);
+		bool advance(uint16_t keys);
+		unsigned long long getFrame() const;
+		unsigned long long getRemoteFrame() const;
+		const RollbackStats& getStats() const;
+	};
+}
+
+#endif //EMU_8_ROLLBACK_H
@@ -0,0 +1,191 @@
+#include "RomAnalysis.h"
+#include <algorithm>
+#include <set>
+#include "Hash.h"
+#include "Machine.h"
+
+namespace Emu8
+{
+	RomAnalysis::RomAnalysis(Profile profile)
+			: memory(new std::array<unsigned char, 65536>()), controlFlow(profile), report()
+	{
+	}
+
+	bool RomAnalysis::analyze(const unsigned char* rom, unsigned int size)
+	{
+		if(size > memory->size() - Machine::PROGRAM_START)
+		{
+			return false;
+		}
+
+		memory->fill(0);
+		std::copy(rom, rom + size, memory->begin() + Machine::PROGRAM_START);
+		controlFlow.analyze(memory->data(), Machine::PROGRAM_START, Machine::PROGRAM_START + size);
+
+		report = RomReport();
+		report.romSize = size;
+		report.romHash = Hash::Fnv1a(rom, size);
+		report.profile = controlFlow.getProfile();
+		report.instructionCount = (unsigned int)controlFlow.getInstructions().size();
+
+		std::set<unsigned short> subroutines;
+		for(unsigned short address : controlFlow.getInstructions())
+		{
+			unsigned short instruction = controlFlow.getInstruction(address);
+			if((instruction & 0xF000) == 0x2000)
+			{
+				subroutines.insert((unsigned short)(instruction & 0x0FFF));
+			}
+			classify(address, instruction);
+			findLoop(address, instruction);
+		}
+		report.subroutineCount = (unsigned int)subroutines.size();
+
+		findStores();
+
+		if(!report.xoChipInstructions.empty())
+		{
+			report.suggestedProfile = Profile::XoChip;
+		}
+		else if(!report.superChipInstructions.empty())
+		{
+			report.suggestedProfile = Profile::SuperChip;
+		}
+		else
+		{
+			report.suggestedProfile = Profile::CosmacVip;
+		}
+
+		return true;
+	}
+
+	void RomAnalysis::findStores()
+	{
+		//Follows I along straight line code from the Annn that sets it. Arriving from a jump, whatever else changes
+		//I, or a store before it is set, leaves where the store lands unknown without running the program.
+		bool known = false;
+		unsigned int iRegister = 0;
+		unsigned int previousEnd = 0;
+
+		for(unsigned short address : controlFlow.getInstructions())
+		{
+			if(address != previousEnd || controlFlow.getLeaders().count(address) > 0)
+			{
+				known = false;
+			}
+			previousEnd = address + controlFlow.getInstructionLength(address);
+
+			unsigned short instruction = controlFlow.getInstruction(address);
+			unsigned int x = (instruction & 0x0F00) >> 8;
+			unsigned int y = (instruction & 0x00F0) >> 4;
+			unsigned int length = 0;
+
+			if((instruction & 0xF0FF) == 0xF055)
+			{
+				length = x + 1;
+			}
+			else if((instruction & 0xF0FF) == 0xF033)
+			{
+				length = 3;
+			}
+			else if((instruction & 0xF00F) == 0x5002)
+			{
+				length = (x > y ? x - y : y - x) + 1;
+			}
+
+			if(length > 0 && !known)
+			{
+				report.unknownStores.push_back((unsigned short)address);
+			}
+			else if(length > 0)
+			{
+				//A store lands on code if it covers any byte of a reachable instruction, including the second half of
+				//one starting just before it.
+				for(unsigned int byte = iRegister; byte < iRegister + length; byte++)
+				{
+					if(controlFlow.isInstruction((unsigned short)byte) || (byte > 0 && controlFlow.isInstruction((unsigned short)(byte - 1))))
+					{
+						report.codeWrites.push_back((unsigned short)address);
+						break;
+					}
+				}
+			}
+
+			if((instruction & 0xF000) == 0xA000)
+			{
+				known = true;
+				iRegister = instruction & 0x0FFF;
+			}
+			else if(instruction == 0xF000 && controlFlow.getProfile() == Profile::XoChip)
+			{
+				known = true;
+				iRegister = controlFlow.getInstruction(address + 2);
+			}
+			else if((instruction & 0xF000) == 0xF000 && ((instruction & 0x00FF) == 0x1E || (instruction & 0x00FF) == 0x29 || (instruction & 0x00FF) == 0x30 || (instruction & 0x00FF) == 0x55 || (instruction & 0x00FF) == 0x65))
+			{
+				//Fx55/Fx65 move I along on some profiles and not on others.
+				known = false;
+			}
+		}
+	}
+
+	void RomAnalysis::findLoop(unsigned short address, unsigned short instruction)
+	{
+		//The same short polling loops Interpreter::skipIdleLoop looks for at runtime.
+		if((instruction & 0xF000) != 0x1000)
+		{
+			return;
+		}
+
+		unsigned short target = (unsigned short)(instruction & 0x0FFF);
+		unsigned short first = controlFlow.getInstruction(target);
+		unsigned short second = controlFlow.getInstruction(target + 2);
+
+		if(target == address)
+		{
+			report.spinLoops.push_back(address);
+		}
+		else if(target + 2 == address && (first & 0xF000) == 0xE000 && ((first & 0x00FF) == 0x9E || (first & 0x00FF) == 0xA1))
+		{
+			report.keyWaitLoops.push_back(target);
+		}
+		else if(target + 4 == address && (first & 0xF0FF) == 0xF007 && ((second & 0xF000) == 0x3000 || (second & 0xF000) == 0x4000) && (second & 0x0F00) == (first & 0x0F00))
+		{
+			report.timerWaitLoops.push_back(target);
+		}
+	}
+
+	void RomAnalysis::classify(unsigned short address, unsigned short instruction)
+	{
+		unsigned short low = instruction & 0x00FF;
+		bool superChip = (instruction & 0xFFF0) == 0x00C0 || (instruction >= 0x00FB && instruction <= 0x00FF) || (instruction & 0xF00F) == 0xD000 || ((instruction & 0xF000) == 0xF000 && (low == 0x30 || low == 0x75 || low == 0x85));
+		bool xoChip = (instruction & 0xFFF0) == 0x00D0 || (instruction & 0xF00F) == 0x5002 || (instruction & 0xF00F) == 0x5003 || instruction == 0xF000 || (instruction & 0xF0FF) == 0xF001 || instruction == 0xF002 || (instruction & 0xF0FF) == 0xF03A;
+
+		if(superChip)
+		{
+			report.superChipInstructions.push_back(address);
+		}
+		if(xoChip)
+		{
+			report.xoChipInstructions.push_back(address);
+		}
+		if((instruction & 0xF000) == 0xB000)
+		{
+			report.indirectJumps.push_back(address);
+		}
+		if(instruction == 0x00FF)
+		{
+			report.hiRes = true;
+		}
+	}
+
+	const RomReport& RomAnalysis::getReport() const
+	{
+		return report;
+	}
+
+	const ControlFlow& RomAnalysis::getControlFlow() const
+	{
+		return controlFlow;
+	}
+}
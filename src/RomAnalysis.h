@@ -0,0 +1,52 @@
+#ifndef EMU_8_ROMANALYSIS_H
+#define EMU_8_ROMANALYSIS_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "ControlFlow.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	//What can be told about a ROM without running it, worked out from the control flow graph of everything reachable
+	//from its entry point. Every list holds the addresses of the instructions concerned.
+	struct RomReport
+	{
+		unsigned int romSize;
+		unsigned long long romHash;
+		Profile profile; //The one the graph was recovered with.
+		Profile suggestedProfile; //The oldest profile that has every instruction used.
+		unsigned int instructionCount;
+		unsigned int subroutineCount;
+		std::vector<unsigned short> codeWrites; //Stores that land on reachable code, the program modifies itself.
+		std::vector<unsigned short> unknownStores; //Stores through an I that isn't known from within the block.
+		std::vector<unsigned short> indirectJumps;
+		std::vector<unsigned short> superChipInstructions;
+		std::vector<unsigned short> xoChipInstructions;
+		std::vector<unsigned short> timerWaitLoops; //Fx07, 3xkk/4xkk, 1nnn back, see Interpreter::skipIdleLoop.
+		std::vector<unsigned short> keyWaitLoops; //Ex9E/ExA1, 1nnn back.
+		std::vector<unsigned short> spinLoops; //1nnn onto itself.
+		bool hiRes;
+	};
+
+	class RomAnalysis
+	{
+	private:
+		std::unique_ptr<std::array<unsigned char, 65536>> memory;
+		ControlFlow controlFlow;
+		RomReport report;
+
+		void findStores();
+		void findLoop(unsigned short address, unsigned short instruction);
+		void classify(unsigned short address, unsigned short instruction);
+
+	public:
+		RomAnalysis(Profile profile);
+		bool analyze(const unsigned char* rom, unsigned int size);
+		const RomReport& getReport() const;
+		const ControlFlow& getControlFlow() const;
+	};
+}
+
+#endif //EMU_8_ROMANALYSIS_H
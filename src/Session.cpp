@@ -0,0 +1,324 @@
+#include "Session.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include "AotModule.h"
+#include "Chip8.h"
+#include "Console.h"
+#include "Display.h"
+
+namespace Emu8
+{
+	Session::Session()
+			: tiles(), keymap(), isRunning(false), focus(0), keypadState(0), redraw(true)
+	{
+	}
+
+	Session::~Session()
+	{
+		release();
+	}
+
+	bool Session::init()
+	{
+		Console::Print("Initializing SDL2...");
+		if(SDL_Init(SDL_INIT_VIDEO) < 0)
+		{
+			Console::Print("SDL2 failed to init!");
+			return false;
+		}
+
+		Chip8::LoadKeymap(keymap);
+
+		if(!Display::Create(1280, 720))
+		{
+			Console::Print("Failed to create display!");
+			return false;
+		}
+
+		return true;
+	}
+
+	void Session::release()
+	{
+		isRunning = false;
+		for(std::unique_ptr<SessionTile>& tile : tiles)
+		{
+			if(tile->worker.joinable())
+			{
+				tile->worker.join();
+			}
+			SDL_FreeSurface(tile->drawing);
+			SDL_FreeSurface(tile->ready);
+			SDL_FreeSurface(tile->shown);
+		}
+		tiles.clear();
+
+		if(Display::GetWindow() != nullptr)
+		{
+			Display::Destroy();
+			SDL_Quit();
+		}
+	}
+
+	bool Session::addGame(std::string filePath, Profile profile)
+	{
+		Console::Print("Loading " + filePath + " as " + Profiles::GetName(profile) + "...");
+
+		std::unique_ptr<SessionTile> tile(new SessionTile());
+		tile->name = filePath;
+		tile->machine = Machine::Create(profile);
+		tile->drawing = SDL_CreateRGBSurface(0, Framebuffer::MAX_WIDTH, Framebuffer::MAX_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+		tile->ready = SDL_CreateRGBSurface(0, Framebuffer::MAX_WIDTH, Framebuffer::MAX_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+		tile->fresh = false;
+		tile->halted = false;
+		tile->keys = 0;
+		tile->keysPressed = 0;
+		tile->shown = SDL_CreateRGBSurface(0, Framebuffer::MAX_WIDTH, Framebuffer::MAX_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+		tile->shownHalted = false;
+
+		if(tile->drawing == nullptr || tile->ready == nullptr || tile->shown == nullptr || !tile->machine->loadGame(filePath))
+		{
+			SDL_FreeSurface(tile->drawing);
+			SDL_FreeSurface(tile->ready);
+			SDL_FreeSurface(tile->shown);
+			return false;
+		}
+
+		const char* aotDirectory = std::getenv("EMU8_AOT_DIR");
+		if(aotDirectory != nullptr && tile->machine->loadAotModule(std::string(aotDirectory) + "/" + AotModule::GetFileName(tile->machine->getRomHash())))
+		{
+			Console::Print("Running translated code for " + filePath + ".");
+		}
+
+		tiles.push_back(std::move(tile));
+		return true;
+	}
+
+	void Session::start()
+	{
+		if(tiles.empty())
+		{
+			return;
+		}
+
+		isRunning = true;
+		for(std::unique_ptr<SessionTile>& tile : tiles)
+		{
+			tile->worker = std::thread(&Session::RunTile, this, std::ref(*tile));
+		}
+
+		//SDL only waits for the display with a renderer, the window surface is flipped straight away, so the loop
+		//sleeps for the rest of the refresh itself.
+		std::chrono::nanoseconds refresh(1000000000 / GetRefreshRate());
+		std::chrono::steady_clock::time_point nextRefresh = std::chrono::steady_clock::now();
+
+		while(isRunning)
+		{
+			SDL_Event event;
+			while(SDL_PollEvent(&event))
+			{
+				ProcessEvent(event);
+			}
+
+			if(Compose())
+			{
+				Display::Flip();
+			}
+
+			nextRefresh += refresh;
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if(nextRefresh < now)
+			{
+				//Running behind, skip the refreshes that were missed instead of composing them back to back.
+				nextRefresh = now;
+			}
+			std::this_thread::sleep_until(nextRefresh);
+		}
+
+		release();
+	}
+
+	void Session::RunTile(SessionTile& tile)
+	{
+		Machine& machine = *tile.machine;
+		Framebuffer drawn; //The frame last drawn into a surface, the surfaces start out blank like the machine.
+		std::chrono::nanoseconds frameLength(1000000000 / FRAMES_PER_SECOND);
+		std::chrono::steady_clock::time_point nextFrame = std::chrono::steady_clock::now();
+
+		while(isRunning)
+		{
+			machine.setKeys(tile.keys.load());
+
+			//Fx0A takes the lowest key that went down since the last frame.
+			uint16_t pressed = tile.keysPressed.exchange(0);
+			if(pressed != 0 && machine.isWaitingForKey())
+			{
+				unsigned char key = 0;
+				while(!(pressed & (1 << key)))
+				{
+					key++;
+				}
+				machine.provideKey(key);
+			}
+
+			machine.runFrame();
+
+			//The frame is drawn here rather than on the presentation thread, which only swaps the finished surface in.
+			const Framebuffer& frame = machine.getState().framebuffer;
+			bool changed = !(frame == drawn);
+			if(changed)
+			{
+				Display::DrawFrame(tile.drawing, frame.getRow(0, 0), frame.getRow(1, 0), frame.isHiRes());
+				drawn = frame;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(tile.frameMutex);
+				if(changed)
+				{
+					std::swap(tile.drawing, tile.ready);
+					tile.fresh = true;
+				}
+				tile.halted = machine.isHalted();
+			}
+
+			if(machine.isHalted())
+			{
+				Console::Print(tile.name + " halted.");
+				return;
+			}
+
+			nextFrame += frameLength;
+			std::this_thread::sleep_until(nextFrame);
+		}
+	}
+
+	void Session::ProcessEvent(const SDL_Event& event)
+	{
+		if(event.type == SDL_QUIT)
+		{
+			isRunning = false;
+		}
+		else if(event.type == SDL_WINDOWEVENT && (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
+		{
+			redraw = true;
+		}
+		else if(event.type == SDL_KEYDOWN && event.key.keysym.scancode == SDL_SCANCODE_TAB)
+		{
+			if(event.key.repeat == 0)
+			{
+				SetFocus((focus + 1) % (unsigned int)tiles.size());
+			}
+		}
+		else if(event.type == SDL_MOUSEBUTTONDOWN)
+		{
+			for(unsigned int i = 0; i < tiles.size(); i++)
+			{
+				SDL_Rect area = Display::GetTileArea(i, (unsigned int)tiles.size());
+				if(event.button.x >= area.x && event.button.x < area.x + area.w && event.button.y >= area.y && event.button.y < area.y + area.h)
+				{
+					SetFocus(i);
+				}
+			}
+		}
+		else if((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0)
+		{
+			SDL_Scancode scancode = event.key.keysym.scancode;
+			if(scancode < 0 || scancode >= SDL_NUM_SCANCODES || keymap[scancode] < 0)
+			{
+				return;
+			}
+
+			uint16_t bit = (uint16_t)(1 << keymap[scancode]);
+			keypadState = event.type == SDL_KEYDOWN ? keypadState | bit : keypadState & ~bit;
+
+			SessionTile& tile = *tiles[focus];
+			tile.keys = keypadState;
+			if(event.type == SDL_KEYDOWN)
+			{
+				tile.keysPressed |= bit;
+			}
+		}
+	}
+
+	void Session::SetFocus(unsigned int index)
+	{
+		//Keys held down stay with the tile they were pressed on, they would never be released otherwise.
+		tiles[focus]->keys = 0;
+		keypadState = 0;
+		focus = index;
+		redraw = true;
+	}
+
+	bool Session::Compose()
+	{
+		//The window surface keeps what was drawn into it, so only the tiles with a new frame are blitted again unless
+		//the whole window has to be redrawn.
+		SDL_Surface* windowSurface = Display::GetWindowSurface();
+		bool drawn = redraw;
+		if(redraw)
+		{
+			SDL_FillRect(windowSurface, nullptr, SDL_MapRGB(windowSurface->format, 32, 32, 32));
+		}
+
+		for(unsigned int i = 0; i < tiles.size(); i++)
+		{
+			SDL_Rect area = Display::GetTileArea(i, (unsigned int)tiles.size());
+			if(redraw && i == focus && tiles.size() > 1)
+			{
+				SDL_Rect border = {area.x - 1, area.y - 1, area.w + 2, area.h + 2};
+				SDL_FillRect(windowSurface, &border, SDL_MapRGB(windowSurface->format, 255, 0, 255));
+			}
+			if(DrawTile(*tiles[i], area))
+			{
+				drawn = true;
+			}
+		}
+
+		redraw = false;
+		return drawn;
+	}
+
+	bool Session::DrawTile(SessionTile& tile, SDL_Rect area)
+	{
+		bool fresh;
+		bool halted;
+		{
+			std::lock_guard<std::mutex> lock(tile.frameMutex);
+			fresh = tile.fresh;
+			halted = tile.halted;
+			if(fresh)
+			{
+				std::swap(tile.ready, tile.shown);
+				tile.fresh = false;
+			}
+		}
+
+		if(!fresh && halted == tile.shownHalted && !redraw)
+		{
+			return false;
+		}
+
+		SDL_BlitScaled(tile.shown, nullptr, Display::GetWindowSurface(), &area);
+		if(halted)
+		{
+			Display::DrawHaltedBar(area);
+		}
+		tile.shownHalted = halted;
+		return true;
+	}
+
+	unsigned int Session::GetRefreshRate()
+	{
+		SDL_DisplayMode mode;
+		int displayIndex = SDL_GetWindowDisplayIndex(Display::GetWindow());
+		if(displayIndex >= 0 && SDL_GetCurrentDisplayMode(displayIndex, &mode) == 0 && mode.refresh_rate > 0)
+		{
+			return (unsigned int)mode.refresh_rate;
+		}
+
+		return FRAMES_PER_SECOND;
+	}
+}
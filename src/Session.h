@@ -0,0 +1,71 @@
+#ifndef EMU_8_SESSION_H
+#define EMU_8_SESSION_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <SDL.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Framebuffer.h"
+#include "Machine.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	//One machine of a tiled session. The worker thread owns the machine and draws its frames, the presentation
+	//thread only takes the last picture it finished and hands it keys through the atomics.
+	struct SessionTile
+	{
+		std::string name;
+		std::unique_ptr<Machine> machine;
+		std::thread worker;
+		std::mutex frameMutex;
+		SDL_Surface* drawing; //The worker's own, the next changed frame is drawn into it.
+		SDL_Surface* ready; //Guarded by frameMutex, like fresh and halted.
+		bool fresh; //Whether ready holds a frame the presentation thread has not taken yet.
+		bool halted;
+		std::atomic<uint16_t> keys;
+		std::atomic<uint16_t> keysPressed; //Keys that went down since the worker last looked, for Fx0A.
+		SDL_Surface* shown; //The presentation thread's own, blitted into the window.
+		bool shownHalted;
+	};
+
+	//Runs several ROMs side by side in one window. Every machine runs on a worker thread of its own at 60 frames a
+	//second and draws its own frames, the presentation thread only blits the tiles that changed once per display
+	//refresh.
+	//
+	//Keys go to the tile with the focus, Tab moves it along and a click picks a tile.
+	class Session
+	{
+	private:
+		static const unsigned int FRAMES_PER_SECOND = 60;
+
+		std::vector<std::unique_ptr<SessionTile>> tiles;
+		std::array<signed char, SDL_NUM_SCANCODES> keymap;
+		std::atomic<bool> isRunning;
+		unsigned int focus;
+		uint16_t keypadState;
+		bool redraw; //Whether the whole window has to be drawn again, after the focus moved or the window was exposed.
+
+		void RunTile(SessionTile& tile);
+		void ProcessEvent(const SDL_Event& event);
+		void SetFocus(unsigned int index);
+		bool Compose();
+		bool DrawTile(SessionTile& tile, SDL_Rect area);
+		unsigned int GetRefreshRate();
+
+	public:
+		Session();
+		~Session();
+		bool init();
+		void release();
+		bool addGame(std::string filePath, Profile profile);
+		void start();
+	};
+}
+
+#endif //EMU_8_SESSION_H
@@ -0,0 +1,180 @@
+#include "SharedExport.h"
+#include <cstring>
+#include <string>
+#include "Console.h"
+#include "Machine.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Emu8
+{
+	const char* SharedExport::NAME_PREFIX = "/emu8-";
+
+	SharedExport::SharedExport()
+			: segment(nullptr), segmentName(), owner(false), pending()
+	{
+	}
+
+	SharedExport::~SharedExport()
+	{
+		close();
+	}
+
+	bool SharedExport::create(std::string name)
+	{
+#ifdef _WIN32
+		Console::Print("Shared memory export needs POSIX shared memory.");
+		return false;
+#else
+		close();
+		segmentName = NAME_PREFIX + name;
+
+		int descriptor = ::shm_open(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+		if(descriptor < 0 || ::ftruncate(descriptor, sizeof(SharedMachineSegment)) < 0)
+		{
+			Console::Print("Failed to create shared memory " + segmentName + "!");
+			if(descriptor >= 0)
+			{
+				::close(descriptor);
+			}
+			return false;
+		}
+
+		void* mapping = ::mmap(nullptr, sizeof(SharedMachineSegment), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		::close(descriptor);
+		if(mapping == MAP_FAILED)
+		{
+			Console::Print("Failed to map shared memory " + segmentName + "!");
+			return false;
+		}
+
+		segment = (SharedMachineSegment*)mapping;
+		segment->magic = SharedMachineSegment::MAGIC;
+		segment->version = SharedMachineSegment::VERSION;
+		segment->generation.store(0, std::memory_order_release);
+		owner = true;
+		return true;
+#endif
+	}
+
+	bool SharedExport::attach(std::string name)
+	{
+#ifdef _WIN32
+		return false;
+#else
+		close();
+		segmentName = name.compare(0, 1, "/") == 0 ? name : NAME_PREFIX + name;
+
+		int descriptor = ::shm_open(segmentName.c_str(), O_RDONLY, 0);
+		if(descriptor < 0)
+		{
+			return false;
+		}
+
+		void* mapping = ::mmap(nullptr, sizeof(SharedMachineSegment), PROT_READ, MAP_SHARED, descriptor, 0);
+		::close(descriptor);
+		if(mapping == MAP_FAILED)
+		{
+			return false;
+		}
+
+		segment = (SharedMachineSegment*)mapping;
+		if(segment->magic != SharedMachineSegment::MAGIC || segment->version != SharedMachineSegment::VERSION)
+		{
+			Console::Print(segmentName + " is not an Emu-8 segment of this version.");
+			close();
+			return false;
+		}
+		owner = false;
+		return true;
+#endif
+	}
+
+	void SharedExport::close()
+	{
+#ifndef _WIN32
+		if(segment == nullptr)
+		{
+			return;
+		}
+
+		::munmap(segment, sizeof(SharedMachineSegment));
+		segment = nullptr;
+
+		//The creator removes the name, readers that still have it mapped keep the memory until they let go.
+		if(owner)
+		{
+			::shm_unlink(segmentName.c_str());
+		}
+#endif
+	}
+
+	bool SharedExport::isOpen() const
+	{
+		return segment != nullptr;
+	}
+
+	void SharedExport::publish(const Machine& machine)
+	{
+		const MachineState& state = machine.getState();
+
+		//Everything is gathered into a private copy first, so the segment only stays odd for one memcpy.
+		pending.frameCount++;
+		pending.instructionsExecuted = machine.getStats().instructionsExecuted;
+		pending.instructionsSkipped = machine.getStats().instructionsSkipped;
+		pending.flags = (state.halted ? SharedMachineData::HALTED : 0) | (state.waitingForKey ? SharedMachineData::WAITING_FOR_KEY : 0) | (state.framebuffer.isHiRes() ? SharedMachineData::HI_RES : 0);
+		pending.iRegister = state.iRegister;
+		pending.programCounter = state.programCounter;
+		std::memcpy(pending.vReg, state.vReg.data(), sizeof(pending.vReg));
+		pending.stackPointer = state.stackPointer;
+		pending.delayRegister = state.delayRegister;
+		pending.soundRegister = state.soundRegister;
+		pending.planeMask = state.planeMask;
+		for(unsigned int plane = 0; plane < Framebuffer::PLANE_COUNT; plane++)
+		{
+			std::memcpy(pending.planes[plane], state.framebuffer.getRow(plane, 0), sizeof(pending.planes[plane]));
+		}
+
+		if(segment == nullptr || !owner)
+		{
+			return;
+		}
+
+		uint32_t generation = segment->generation.load(std::memory_order_relaxed);
+		segment->generation.store(generation + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&segment->data, &pending, sizeof(pending));
+		segment->generation.store(generation + 2, std::memory_order_release);
+	}
+
+	bool SharedExport::read(SharedMachineData& data) const
+	{
+		if(segment == nullptr)
+		{
+			return false;
+		}
+
+		//A torn copy is detected by the generation moving, a frame takes microseconds to write so a few tries do.
+		for(unsigned int attempt = 0; attempt < 64; attempt++)
+		{
+			uint32_t before = segment->generation.load(std::memory_order_acquire);
+			if(before & 1)
+			{
+				continue;
+			}
+
+			std::memcpy(&data, (const void*)&segment->data, sizeof(data));
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			if(segment->generation.load(std::memory_order_relaxed) == before)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
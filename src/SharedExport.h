@@ -0,0 +1,72 @@
+#ifndef EMU_8_SHAREDEXPORT_H
+#define EMU_8_SHAREDEXPORT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Framebuffer.h"
+
+namespace Emu8
+{
+	class Machine;
+
+	//What a machine publishes once per frame. Plain data, readers copy it out of the segment as a whole.
+	struct SharedMachineData
+	{
+		static const uint32_t HALTED = 1;
+		static const uint32_t WAITING_FOR_KEY = 2;
+		static const uint32_t HI_RES = 4;
+
+		uint64_t frameCount;
+		uint64_t instructionsExecuted;
+		uint64_t instructionsSkipped;
+		uint32_t flags;
+		uint16_t iRegister;
+		uint16_t programCounter;
+		uint8_t vReg[16];
+		uint8_t stackPointer;
+		uint8_t delayRegister;
+		uint8_t soundRegister;
+		uint8_t planeMask;
+		uint64_t planes[Framebuffer::PLANE_COUNT][Framebuffer::MAX_HEIGHT * Framebuffer::WORDS_PER_ROW]; //Packed like Framebuffer.
+	};
+
+	//The layout of the segment. generation is odd while the machine is writing, a reader copies data out between two
+	//loads of an even generation and retries if it changed, so neither side ever waits on the other.
+	struct SharedMachineSegment
+	{
+		static const uint32_t MAGIC = 0x38554D45; //"EMU8"
+		static const uint32_t VERSION = 1;
+
+		uint32_t magic;
+		uint32_t version;
+		std::atomic<uint32_t> generation;
+		uint32_t reserved;
+		SharedMachineData data;
+	};
+
+	//Publishes a machine into, or reads one back out of, a POSIX shared memory segment named /emu8-<name>.
+	class SharedExport
+	{
+	private:
+		SharedMachineSegment* segment;
+		std::string segmentName;
+		bool owner;
+		SharedMachineData pending;
+
+	public:
+		static const char* NAME_PREFIX;
+
+		SharedExport();
+		~SharedExport();
+		bool create(std::string name);
+		bool attach(std::string name);
+		void close();
+		bool isOpen() const;
+		void publish(const Machine& machine);
+		bool read(SharedMachineData& data) const;
+	};
+}
+
+#endif //EMU_8_SHAREDEXPORT_H
@@ -0,0 +1,361 @@
+#include "TerminalDisplay.h"
+#include <cstring>
+#include <string>
+
+namespace Emu8
+{
+	namespace
+	{
+		//The same colours the window uses as near as the 16 ANSI ones get: black, white, grey and red.
+		const std::array<unsigned int, 4> FOREGROUND_CODES = {30, 97, 37, 91};
+		const std::array<unsigned int, 4> BACKGROUND_CODES = {40, 107, 47, 101};
+
+		//Braille dots are numbered down the left column and then the right, with the bottom row added last.
+		const std::array<std::array<uint8_t, 4>, 2> BRAILLE_DOTS =
+				{
+						{
+								{0x01, 0x02, 0x04, 0x40},
+								{0x08, 0x10, 0x20, 0x80}
+						}
+				};
+
+		//A cell never takes more than a cursor movement, a colour change and a three byte glyph.
+		const unsigned int MAX_CELL_BYTES = 32;
+	}
+
+	const unsigned int TerminalDisplay::MAX_COLUMNS;
+	const unsigned int TerminalDisplay::MAX_ROWS;
+
+	bool TerminalDisplay::ParseMode(std::string name, TerminalMode& mode)
+	{
+		if(name == "blocks")
+		{
+			mode = TerminalMode::HalfBlocks;
+			return true;
+		}
+		if(name == "braille")
+		{
+			mode = TerminalMode::Braille;
+			return true;
+		}
+		return false;
+	}
+
+	TerminalDisplay::TerminalDisplay()
+			: stream(nullptr), mode(TerminalMode::HalfBlocks), refreshInterval(), nextRefresh(), cells(), columns(0), rows(0), redraw(true), suspended(false), output(), outputLength(0), cursorColumn(-1), cursorRow(-1), foreground(-1), background(-1), refreshes(0), bytesWritten(0), lastBytes(0)
+	{
+	}
+
+	TerminalDisplay::~TerminalDisplay()
+	{
+		close();
+	}
+
+	bool TerminalDisplay::open(std::FILE* stream, TerminalMode mode, unsigned int refreshRate)
+	{
+		close();
+		if(stream == nullptr)
+		{
+			return false;
+		}
+
+		this->stream = stream;
+		this->mode = mode;
+		refreshInterval = refreshRate > 0 ? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(1000000000 / refreshRate)) : std::chrono::steady_clock::duration::zero();
+		nextRefresh = std::chrono::steady_clock::now();
+		output.resize(MAX_COLUMNS * MAX_ROWS * MAX_CELL_BYTES);
+		redraw = true;
+		suspended = false;
+		foreground = -1;
+		background = -1;
+		refreshes = 0;
+		bytesWritten = 0;
+
+		//Switch to the alternate screen and hide the cursor.
+		outputLength = 0;
+		append("\x1b[?1049h\x1b[?25l");
+		flush();
+		return true;
+	}
+
+	bool TerminalDisplay::present(const Framebuffer& framebuffer)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if(stream == nullptr || now < nextRefresh)
+		{
+			return false;
+		}
+
+		//Keep to the rate on average, but don't try to make up for refreshes missed while nothing called.
+		nextRefresh += refreshInterval;
+		if(nextRefresh < now)
+		{
+			nextRefresh = now;
+		}
+
+		outputLength = 0;
+		if(suspended)
+		{
+			append("\x1b[?1049h\x1b[?25l");
+			suspended = false;
+			redraw = true;
+		}
+
+		//Whatever else writes to the terminal moves the cursor, so the first changed cell always addresses it.
+		cursorColumn = -1;
+		cursorRow = -1;
+
+		unsigned int newColumns = mode == TerminalMode::HalfBlocks ? framebuffer.getWidth() : framebuffer.getWidth() / 2;
+		unsigned int newRows = mode == TerminalMode::HalfBlocks ? framebuffer.getHeight() / 2 : framebuffer.getHeight() / 4;
+		if(redraw || newColumns != columns || newRows != rows)
+		{
+			//Clearing fills the screen with the background colour, which is what a blank cell is.
+			columns = newColumns;
+			rows = newRows;
+			setColors(-1, 0);
+			append("\x1b[2J");
+			cells.fill(0);
+			redraw = false;
+		}
+
+		for(unsigned int row = 0; row < rows; row++)
+		{
+			for(unsigned int column = 0; column < columns; column++)
+			{
+				uint16_t cell = getCell(framebuffer, column, row);
+				if(cell != cells[row * MAX_COLUMNS + column])
+				{
+					moveTo(column, row);
+					drawCell(column, row, cell);
+					cells[row * MAX_COLUMNS + column] = cell;
+				}
+			}
+		}
+
+		flush();
+		refreshes++;
+		return true;
+	}
+
+	void TerminalDisplay::suspend()
+	{
+		//Gives the normal screen back to something that has to print, such as the debugger prompt. The next refresh
+		//goes back to the alternate screen and draws the whole picture again.
+		if(stream == nullptr || suspended)
+		{
+			return;
+		}
+
+		outputLength = 0;
+		append("\x1b[0m\x1b[?25h\x1b[?1049l");
+		flush();
+		suspended = true;
+		foreground = -1;
+		background = -1;
+	}
+
+	void TerminalDisplay::close()
+	{
+		if(stream == nullptr)
+		{
+			return;
+		}
+
+		//A suspended display has already left the alternate screen.
+		if(!suspended)
+		{
+			outputLength = 0;
+			append("\x1b[0m\x1b[?25h\x1b[?1049l");
+			flush();
+		}
+		stream = nullptr;
+	}
+
+	bool TerminalDisplay::isOpen() const
+	{
+		return stream != nullptr;
+	}
+
+	unsigned long long TerminalDisplay::getRefreshes() const
+	{
+		return refreshes;
+	}
+
+	unsigned long long TerminalDisplay::getBytesWritten() const
+	{
+		return bytesWritten;
+	}
+
+	unsigned int TerminalDisplay::getLastBytes() const
+	{
+		return lastBytes;
+	}
+
+	uint16_t TerminalDisplay::getCell(const Framebuffer& framebuffer, unsigned int column, unsigned int row) const
+	{
+		//Half blocks hold the top pixel in the low two bits and the bottom one above. Braille cells hold the dots in
+		//the low byte and the colour of all lit pixels or'd together above, which only matters with two planes.
+		if(mode == TerminalMode::HalfBlocks)
+		{
+			return (uint16_t)(framebuffer.getPixel(column, row * 2) | (framebuffer.getPixel(column, row * 2 + 1) << 2));
+		}
+
+		uint16_t dots = 0;
+		uint16_t color = 0;
+		for(unsigned int x = 0; x < 2; x++)
+		{
+			for(unsigned int y = 0; y < 4; y++)
+			{
+				unsigned char pixel = framebuffer.getPixel(column * 2 + x, row * 4 + y);
+				if(pixel != 0)
+				{
+					dots |= BRAILLE_DOTS[x][y];
+					color |= pixel;
+				}
+			}
+		}
+		return (uint16_t)(dots | (color << 8));
+	}
+
+	void TerminalDisplay::drawCell(unsigned int column, unsigned int row, uint16_t cell)
+	{
+		if(mode == TerminalMode::HalfBlocks)
+		{
+			//Every cell can be drawn two ways, the one that needs fewer colour changes wins.
+			int top = cell & 3;
+			int bottom = (cell >> 2) & 3;
+			if(top == bottom && background == top)
+			{
+				append(" ");
+			}
+			else if(top == bottom && foreground == top)
+			{
+				append("\xe2\x96\x88");
+			}
+			else if(top == bottom)
+			{
+				setColors(-1, top);
+				append(" ");
+			}
+			else if((foreground != top) + (background != bottom) <= (foreground != bottom) + (background != top))
+			{
+				setColors(top, bottom);
+				append("\xe2\x96\x80");
+			}
+			else
+			{
+				setColors(bottom, top);
+				append("\xe2\x96\x84");
+			}
+		}
+		else
+		{
+			//An empty cell is a space on the black background, which is a third the size of the empty pattern.
+			unsigned int dots = cell & 0xFF;
+			setColors(dots != 0 ? cell >> 8 : -1, 0);
+			if(dots == 0)
+			{
+				append(" ");
+			}
+			else
+			{
+				char glyph[4] = {(char)0xE2, (char)(0xA0 | (dots >> 6)), (char)(0x80 | (dots & 0x3F)), '\0'};
+				append(glyph);
+			}
+		}
+
+		//Writing the last column leaves the cursor waiting to wrap, where it is best not to rely on it.
+		cursorColumn = column + 1 < columns ? (int)column + 1 : -1;
+		cursorRow = (int)row;
+	}
+
+	void TerminalDisplay::moveTo(unsigned int column, unsigned int row)
+	{
+		if(cursorRow == (int)row && cursorColumn == (int)column)
+		{
+			return;
+		}
+
+		if(cursorRow == (int)row && cursorColumn >= 0 && (int)column > cursorColumn)
+		{
+			//Forward along the row is shorter than an absolute position.
+			append("\x1b[");
+			if(column - cursorColumn > 1)
+			{
+				appendNumber(column - cursorColumn);
+			}
+			append("C");
+		}
+		else
+		{
+			append("\x1b[");
+			appendNumber(row + 1);
+			append(";");
+			appendNumber(column + 1);
+			append("H");
+		}
+
+		cursorColumn = (int)column;
+		cursorRow = (int)row;
+	}
+
+	void TerminalDisplay::setColors(int foreground, int background)
+	{
+		//-1 leaves a colour as it is.
+		bool setForeground = foreground >= 0 && foreground != this->foreground;
+		bool setBackground = background >= 0 && background != this->background;
+		if(!setForeground && !setBackground)
+		{
+			return;
+		}
+
+		append("\x1b[");
+		if(setForeground)
+		{
+			appendNumber(FOREGROUND_CODES[foreground]);
+			this->foreground = foreground;
+		}
+		if(setBackground)
+		{
+			append(setForeground ? ";" : "");
+			appendNumber(BACKGROUND_CODES[background]);
+			this->background = background;
+		}
+		append("m");
+	}
+
+	void TerminalDisplay::append(const char* text)
+	{
+		size_t length = std::strlen(text);
+		std::memcpy(output.data() + outputLength, text, length);
+		outputLength += length;
+	}
+
+	void TerminalDisplay::appendNumber(unsigned int number)
+	{
+		char digits[12];
+		unsigned int count = 0;
+		do
+		{
+			digits[count++] = (char)('0' + number % 10);
+			number /= 10;
+		}
+		while(number > 0);
+
+		while(count > 0)
+		{
+			output[outputLength++] = digits[--count];
+		}
+	}
+
+	void TerminalDisplay::flush()
+	{
+		lastBytes = (unsigned int)outputLength;
+		bytesWritten += outputLength;
+		if(outputLength > 0)
+		{
+			std::fwrite(output.data(), 1, outputLength, stream);
+			std::fflush(stream);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef EMU_8_TERMINALDISPLAY_H
+#define EMU_8_TERMINALDISPLAY_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Framebuffer.h"
+
+namespace Emu8
+{
+	enum class TerminalMode
+	{
+		HalfBlocks, //One cell per column and two rows, in all four colours.
+		Braille //One cell per 2x4 pixels, each cell in the colour of all its lit pixels together.
+	};
+
+	//Draws the framebuffer into an ANSI terminal for machines without a display, such as a server reached over SSH.
+	//Only the cells that changed since the last refresh are written, each reached with the shortest cursor movement
+	//and with colours set only when they differ from the ones in effect, and refreshes are held to the given rate no
+	//matter how often present is called. A still screen costs nothing but the cell comparisons.
+	//
+	//The picture is drawn at the native resolution of the framebuffer on the alternate screen, which close leaves
+	//again so the terminal is as it was.
+	class TerminalDisplay
+	{
+	public:
+		static const unsigned int MAX_COLUMNS = Framebuffer::MAX_WIDTH;
+		static const unsigned int MAX_ROWS = Framebuffer::MAX_HEIGHT / 2;
+
+	private:
+		std::FILE* stream;
+		TerminalMode mode;
+		std::chrono::steady_clock::duration refreshInterval;
+		std::chrono::steady_clock::time_point nextRefresh;
+		std::array<uint16_t, MAX_COLUMNS * MAX_ROWS> cells; //What the terminal shows, see getCell.
+		unsigned int columns;
+		unsigned int rows;
+		bool redraw;
+		bool suspended; //Whether suspend handed the normal screen back.
+		std::vector<char> output;
+		size_t outputLength;
+		int cursorColumn; //-1 when unknown.
+		int cursorRow;
+		int foreground; //Palette index, -1 when unknown.
+		int background;
+		unsigned long long refreshes;
+		unsigned long long bytesWritten;
+		unsigned int lastBytes;
+
+		uint16_t getCell(const Framebuffer& framebuffer, unsigned int column, unsigned int row) const;
+		void drawCell(unsigned int column, unsigned int row, uint16_t cell);
+		void moveTo(unsigned int column, unsigned int row);
+		void setColors(int foreground, int background);
+		void append(const char* text);
+		void appendNumber(unsigned int number);
+		void flush();
+
+	public:
+		static bool ParseMode(std::string name, TerminalMode& mode);
+
+		TerminalDisplay();
+		~TerminalDisplay();
+		bool open(std::FILE* stream, TerminalMode mode, unsigned int refreshRate);
+		bool present(const Framebuffer& framebuffer);
+		void suspend();
+		void close();
+		bool isOpen() const;
+		unsigned long long getRefreshes() const;
+		unsigned long long getBytesWritten() const;
+		unsigned int getLastBytes() const;
+	};
+}
+
+#endif //EMU_8_TERMINALDISPLAY_H
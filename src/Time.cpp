@@ -8,6 +8,11 @@ namespace Emu8
 	{
 	}
 
+	Time::Time(int fpsLimit)
+			: nextUpdateTicks(SDL_GetTicks()), fpsLimit(fpsLimit), fpsCount(), fpsTicks(SDL_GetTicks()), fpsPerSecond()
+	{
+	}
+
 	bool Time::canUpdate()
 	{
 		int ticks = SDL_GetTicks();
@@ -14,6 +14,7 @@ namespace Emu8
 
 	public:
 		Time();
+		Time(int fpsLimit);
 		bool canUpdate();
 		int ticksTillUpdate();
 		int getFPS();
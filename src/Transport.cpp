@@ -0,0 +1,226 @@
+#include "Transport.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include "Console.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Emu8
+{
+	namespace
+	{
+#ifdef _WIN32
+		typedef SOCKET NativeSocket;
+#else
+		typedef int NativeSocket;
+#endif
+	}
+
+	Transport::~Transport()
+	{
+	}
+
+	void LoopbackTransport::Connect(LoopbackTransport& first, LoopbackTransport& second)
+	{
+		std::shared_ptr<Pipe> firstToSecond(new Pipe());
+		std::shared_ptr<Pipe> secondToFirst(new Pipe());
+
+		first.outbound = firstToSecond;
+		first.inbound = secondToFirst;
+		second.outbound = secondToFirst;
+		second.inbound = firstToSecond;
+	}
+
+	LoopbackTransport::LoopbackTransport()
+			: inbound(), outbound(), packetsSent(0), latency(0), dropEvery(0)
+	{
+	}
+
+	void LoopbackTransport::setLatency(unsigned int packets)
+	{
+		latency = packets;
+	}
+
+	void LoopbackTransport::setDropEvery(unsigned int packets)
+	{
+		dropEvery = packets;
+	}
+
+	bool LoopbackTransport::send(const void* data, unsigned int size)
+	{
+		if(outbound == nullptr || size > MAX_PACKET_SIZE)
+		{
+			return false;
+		}
+
+		packetsSent++;
+		if(dropEvery > 0 && packetsSent % dropEvery == 0)
+		{
+			return true;
+		}
+
+		Packet packet = {packetsSent + latency, std::vector<unsigned char>((const unsigned char*)data, (const unsigned char*)data + size)};
+		std::lock_guard<std::mutex> lock(outbound->mutex);
+		outbound->packets.push_back(std::move(packet));
+		return true;
+	}
+
+	bool LoopbackTransport::receive(void* data, unsigned int capacity, unsigned int& size)
+	{
+		if(inbound == nullptr)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(inbound->mutex);
+		if(inbound->packets.empty() || inbound->packets.front().deliverAfter > packetsSent)
+		{
+			return false;
+		}
+
+		//Like a datagram socket, whatever doesn't fit is cut off.
+		Packet& packet = inbound->packets.front();
+		size = (unsigned int)std::min<size_t>(capacity, packet.data.size());
+		std::memcpy(data, packet.data.data(), size);
+		inbound->packets.pop_front();
+		return true;
+	}
+
+	UdpTransport::UdpTransport()
+			: handle(-1)
+	{
+	}
+
+	UdpTransport::~UdpTransport()
+	{
+		close();
+	}
+
+	bool UdpTransport::open(unsigned short localPort, std::string remoteHost, unsigned short remotePort)
+	{
+		close();
+
+#ifdef _WIN32
+		WSADATA data;
+		if(WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		{
+			Console::Print("Failed to start Winsock!");
+			return false;
+		}
+#endif
+
+		NativeSocket native = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if(native == (NativeSocket)-1)
+		{
+#ifdef _WIN32
+			WSACleanup();
+#endif
+			Console::Print("Failed to create a UDP socket!");
+			return false;
+		}
+		handle = (intptr_t)native;
+
+		addrinfo hints = addrinfo();
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo* remote = nullptr;
+		if(getaddrinfo(remoteHost.c_str(), std::to_string(remotePort).c_str(), &hints, &remote) != 0 || remote == nullptr)
+		{
+			Console::Print("Could not resolve " + remoteHost + ".");
+			close();
+			return false;
+		}
+
+		sockaddr_in local = sockaddr_in();
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(INADDR_ANY);
+		local.sin_port = htons(localPort);
+
+		bool connected = bind((NativeSocket)handle, (const sockaddr*)&local, sizeof(local)) == 0 && connect((NativeSocket)handle, remote->ai_addr, (int)remote->ai_addrlen) == 0;
+		freeaddrinfo(remote);
+
+		if(!connected)
+		{
+			Console::Print("Could not open UDP port " + std::to_string(localPort) + " to " + remoteHost + ":" + std::to_string(remotePort) + ".");
+			close();
+			return false;
+		}
+
+#ifdef _WIN32
+		u_long nonBlocking = 1;
+		ioctlsocket((SOCKET)handle, FIONBIO, &nonBlocking);
+#else
+		fcntl((int)handle, F_SETFL, fcntl((int)handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+		return true;
+	}
+
+	void UdpTransport::close()
+	{
+#ifdef _WIN32
+		if(handle != -1)
+		{
+			closesocket((SOCKET)handle);
+			WSACleanup();
+		}
+#else
+		if(handle != -1)
+		{
+			::close((int)handle);
+		}
+#endif
+		handle = -1;
+	}
+
+	bool UdpTransport::isOpen() const
+	{
+		return handle != -1;
+	}
+
+	bool UdpTransport::send(const void* data, unsigned int size)
+	{
+		//A full send buffer or a peer that isn't listening yet only loses the packet, the next one repeats it.
+		return handle != -1 && ::send((NativeSocket)handle, (const char*)data, (int)size, 0) == (int)size;
+	}
+
+	bool UdpTransport::receive(void* data, unsigned int capacity, unsigned int& size)
+	{
+		if(handle == -1)
+		{
+			return false;
+		}
+
+		//Errors such as the ICMP unreachable a send to a peer that isn't up yet leaves behind are skipped over.
+		for(unsigned int attempt = 0; attempt < 16; attempt++)
+		{
+			int received = (int)recv((NativeSocket)handle, (char*)data, (int)capacity, 0);
+			if(received >= 0)
+			{
+				size = (unsigned int)received;
+				return true;
+			}
+#ifdef _WIN32
+			if(WSAGetLastError() == WSAEWOULDBLOCK)
+#else
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+#endif
+			{
+				return false;
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef EMU_8_TRANSPORT_H
+#define EMU_8_TRANSPORT_H
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Emu8
+{
+	//Carries datagrams between the two peers of a netplay session. Delivery is best effort and unordered, like UDP,
+	//and neither call ever blocks.
+	class Transport
+	{
+	public:
+		static const unsigned int MAX_PACKET_SIZE = 512;
+
+		virtual ~Transport();
+		virtual bool send(const void* data, unsigned int size) = 0;
+		virtual bool receive(void* data, unsigned int capacity, unsigned int& size) = 0; //False when nothing arrived.
+	};
+
+	//Two transports connected in process, so both peers of a session can run on one machine. Latency is counted in
+	//packets sent rather than time: a packet sent as a side's nth arrives once the other side has sent n + latency,
+	//which for a rollback session sending one per frame is a latency in frames, and a run is repeatable no matter
+	//how fast it goes.
+	class LoopbackTransport : public Transport
+	{
+	private:
+		struct Packet
+		{
+			unsigned long long deliverAfter;
+			std::vector<unsigned char> data;
+		};
+
+		struct Pipe
+		{
+			std::mutex mutex;
+			std::deque<Packet> packets;
+		};
+
+		std::shared_ptr<Pipe> inbound;
+		std::shared_ptr<Pipe> outbound;
+		unsigned long long packetsSent;
+		unsigned int latency;
+		unsigned int dropEvery;
+
+	public:
+		static void Connect(LoopbackTransport& first, LoopbackTransport& second);
+
+		LoopbackTransport();
+		void setLatency(unsigned int packets);
+		void setDropEvery(unsigned int packets); //Loses every nth packet sent, 0 loses none.
+		bool send(const void* data, unsigned int size) override;
+		bool receive(void* data, unsigned int capacity, unsigned int& size) override;
+	};
+
+	//A connected, non-blocking UDP socket.
+	class UdpTransport : public Transport
+	{
+	private:
+		intptr_t handle;
+
+		UdpTransport(const UdpTransport& other);
+		UdpTransport& operator=(const UdpTransport& other);
+
+	public:
+		UdpTransport();
+		~UdpTransport();
+		bool open(unsigned short localPort, std::string remoteHost, unsigned short remotePort);
+		void close();
+		bool isOpen() const;
+		bool send(const void* data, unsigned int size) override;
+		bool receive(void* data, unsigned int capacity, unsigned int& size) override;
+	};
+}
+
+#endif //EMU_8_TRANSPORT_H
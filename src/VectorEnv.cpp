@@ -0,0 +1,312 @@
+#include "VectorEnv.h"
+#include <algorithm>
+
+namespace Emu8
+{
+	VectorEnv::VectorEnv()
+			: machines(), initialState(), probes(), observations(), rewards(), dones(), episodeFrames(), jobSeeds(nullptr), jobActions(nullptr), frameSkip(1), maxEpisodeFrames(0), workers(), threadCount(1), jobMutex(), jobStarted(), jobFinished(), job(Job::None), jobGeneration(0), workersBusy(0)
+	{
+	}
+
+	VectorEnv::~VectorEnv()
+	{
+		if(!workers.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(jobMutex);
+				job = Job::Quit;
+				jobGeneration++;
+			}
+			jobStarted.notify_all();
+
+			for(std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+	}
+
+	bool VectorEnv::create(const unsigned char* rom, unsigned int romSize, Profile profile, unsigned int count, unsigned int threads)
+	{
+		if(count == 0 || !machines.empty())
+		{
+			return false;
+		}
+
+		for(unsigned int i = 0; i < count; i++)
+		{
+			machines.push_back(Machine::Create(profile));
+
+			if(!machines.back()->loadGame(rom, romSize))
+			{
+				machines.clear();
+				return false;
+			}
+		}
+
+		//Every machine starts from the same snapshot, which is also what Machine::resetTo goes back to.
+		initialState.reset(new MachineState());
+		machines[0]->saveState(*initialState);
+		for(unsigned int i = 1; i < count; i++)
+		{
+			machines[i]->restoreState(*initialState);
+		}
+
+		observations.assign((size_t)count * OBSERVATION_SIZE, 0);
+		rewards.assign(count, 0.0f);
+		dones.assign(count, 0);
+		episodeFrames.assign(count, 0);
+
+		//The calling thread takes the first slice of machines itself, so one thread means no workers at all.
+		threadCount = std::max(1u, std::min(threads == 0 ? std::thread::hardware_concurrency() : threads, count));
+		for(unsigned int i = 1; i < threadCount; i++)
+		{
+			workers.push_back(std::thread(&VectorEnv::workerLoop, this, i));
+		}
+
+		return true;
+	}
+
+	void VectorEnv::setFrameSkip(unsigned int frameSkip)
+	{
+		this->frameSkip = std::max(1u, frameSkip);
+	}
+
+	void VectorEnv::setMaxEpisodeFrames(unsigned int maxEpisodeFrames)
+	{
+		this->maxEpisodeFrames = maxEpisodeFrames;
+	}
+
+	void VectorEnv::setCyclesPerFrame(unsigned int cyclesPerFrame)
+	{
+		for(std::unique_ptr<Machine>& machine : machines)
+		{
+			machine->setCyclesPerFrame(cyclesPerFrame);
+		}
+	}
+
+	void VectorEnv::addProbe(const RewardProbe& probe)
+	{
+		probes.push_back(probe);
+	}
+
+	void VectorEnv::reset(const uint32_t* seeds)
+	{
+		jobSeeds = seeds;
+		runJob(Job::Reset);
+	}
+
+	void VectorEnv::step(const uint16_t* actions)
+	{
+		jobActions = actions;
+		runJob(Job::Step);
+	}
+
+	unsigned int VectorEnv::getCount() const
+	{
+		return (unsigned int)machines.size();
+	}
+
+	const uint8_t* VectorEnv::getObservations() const
+	{
+		return observations.data();
+	}
+
+	const float* VectorEnv::getRewards() const
+	{
+		return rewards.data();
+	}
+
+	const uint8_t* VectorEnv::getDones() const
+	{
+		return dones.data();
+	}
+
+	Machine& VectorEnv::getMachine(unsigned int index)
+	{
+		return *machines[index];
+	}
+
+	void VectorEnv::workerLoop(unsigned int worker)
+	{
+		unsigned long long seenGeneration = 0;
+		unsigned int count = (unsigned int)machines.size();
+
+		while(true)
+		{
+			Job current;
+			{
+				std::unique_lock<std::mutex> lock(jobMutex);
+				jobStarted.wait(lock, [&]() { return jobGeneration != seenGeneration; });
+				seenGeneration = jobGeneration;
+				current = job;
+			}
+
+			if(current == Job::Quit)
+			{
+				return;
+			}
+
+			for(unsigned int i = worker * count / threadCount; i < (worker + 1) * count / threadCount; i++)
+			{
+				if(current == Job::Reset)
+				{
+					resetMachine(i, jobSeeds != nullptr ? jobSeeds[i] : i + 1);
+				}
+				else
+				{
+					stepMachine(i, jobActions != nullptr ? jobActions[i] : 0);
+				}
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(jobMutex);
+				workersBusy--;
+			}
+			jobFinished.notify_one();
+		}
+	}
+
+	void VectorEnv::runJob(Job job)
+	{
+		unsigned int count = (unsigned int)machines.size();
+
+		if(!workers.empty())
+		{
+			{
+				std::lock_guard<std::mutex> lock(jobMutex);
+				this->job = job;
+				workersBusy = (unsigned int)workers.size();
+				jobGeneration++;
+			}
+			jobStarted.notify_all();
+		}
+
+		for(unsigned int i = 0; i < count / threadCount; i++)
+		{
+			if(job == Job::Reset)
+			{
+				resetMachine(i, jobSeeds != nullptr ? jobSeeds[i] : i + 1);
+			}
+			else
+			{
+				stepMachine(i, jobActions != nullptr ? jobActions[i] : 0);
+			}
+		}
+
+		if(!workers.empty())
+		{
+			std::unique_lock<std::mutex> lock(jobMutex);
+			jobFinished.wait(lock, [&]() { return workersBusy == 0; });
+		}
+	}
+
+	void VectorEnv::resetMachine(unsigned int index, uint32_t seed)
+	{
+		machines[index]->resetTo(*initialState);
+		machines[index]->setRandomSeed(seed);
+		rewards[index] = 0.0f;
+		dones[index] = 0;
+		episodeFrames[index] = 0;
+		writeObservation(index);
+	}
+
+	void VectorEnv::stepMachine(unsigned int index, uint16_t keys)
+	{
+		Machine& machine = *machines[index];
+		double before = readProbes(machine.getState());
+
+		for(unsigned char key = 0; key < 16; key++)
+		{
+			machine.setKey(key, (keys >> key) & 1);
+		}
+
+		//Fx0A takes the lowest key held, a program waiting on it with nothing held just sits out the frames.
+		for(unsigned int frame = 0; frame < frameSkip && !machine.isHalted(); frame++)
+		{
+			if(machine.isWaitingForKey() && keys != 0)
+			{
+				unsigned char key = 0;
+				while(!((keys >> key) & 1))
+				{
+					key++;
+				}
+				machine.provideKey(key);
+			}
+			machine.runFrame();
+		}
+
+		episodeFrames[index] += frameSkip;
+		rewards[index] = (float)(readProbes(machine.getState()) - before);
+		dones[index] = machine.isHalted() || (maxEpisodeFrames > 0 && episodeFrames[index] >= maxEpisodeFrames);
+
+		//A finished episode starts over straight away, so the observation is already the first one of the next.
+		//The new seed carries on from the old random state, so runs stay reproducible from the seeds given to reset.
+		if(dones[index])
+		{
+			uint32_t seed = machine.getState().randomState;
+			float reward = rewards[index];
+
+			resetMachine(index, seed);
+			rewards[index] = reward;
+			dones[index] = 1;
+			return;
+		}
+
+		writeObservation(index);
+	}
+
+	double VectorEnv::readProbes(const MachineState& state) const
+	{
+		double total = 0.0;
+
+		for(const RewardProbe& probe : probes)
+		{
+			uint32_t value = 0;
+
+			if(probe.isRegister)
+			{
+				value = state.vReg[probe.address & 0xF];
+			}
+			else
+			{
+				for(unsigned int i = 0; i < probe.length; i++)
+				{
+					value = (value << 8) | state.mainMem[(probe.address + i) & 0xFFFF];
+				}
+			}
+			total += probe.weight * (double)value;
+		}
+		return total;
+	}
+
+	void VectorEnv::writeObservation(unsigned int index)
+	{
+		const Framebuffer& framebuffer = machines[index]->getState().framebuffer;
+		uint8_t* out = &observations[(size_t)index * OBSERVATION_SIZE];
+		unsigned int scale = OBSERVATION_WIDTH / framebuffer.getWidth();
+
+		for(unsigned int y = 0; y < OBSERVATION_HEIGHT; y++, out += OBSERVATION_WIDTH)
+		{
+			//Doubled low resolution rows are the row above over again.
+			if(scale == 2 && y % 2 == 1)
+			{
+				std::copy(out - OBSERVATION_WIDTH, out, out);
+				continue;
+			}
+
+			const uint64_t* plane0 = framebuffer.getRow(0, y / scale);
+			const uint64_t* plane1 = framebuffer.getRow(1, y / scale);
+
+			for(unsigned int x = 0; x < OBSERVATION_WIDTH; x += scale)
+			{
+				unsigned int word = x / scale / 64;
+				unsigned int shift = 63 - x / scale % 64;
+				uint8_t pixel = (uint8_t)(((plane0[word] >> shift) & 1) | (((plane1[word] >> shift) & 1) << 1));
+
+				out[x] = pixel;
+				out[x + scale - 1] = pixel;
+			}
+		}
+	}
+}
@@ -0,0 +1,90 @@
+#ifndef EMU_8_VECTORENV_H
+#define EMU_8_VECTORENV_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Machine.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	//A value the reward is computed from, either a run of memory read as a big endian number or one of V0-VF.
+	struct RewardProbe
+	{
+		bool isRegister;
+		unsigned short address; //Register index when isRegister is set.
+		unsigned char length; //1 to 4 bytes, ignored for registers.
+		float weight; //Reward per step is weight * (value after the step - value before it), summed over the probes.
+	};
+
+	//N copies of the same ROM stepped together by a pool of worker threads, for training agents. The observations,
+	//rewards and done flags live in buffers allocated once up front and written in place by every reset and step,
+	//so callers can keep views on them instead of copying. Each observation is 64 rows of 128 bytes holding the
+	//pixel's plane bits, low resolution pixels are doubled to fill it.
+	class VectorEnv
+	{
+	public:
+		static const unsigned int OBSERVATION_WIDTH = 128;
+		static const unsigned int OBSERVATION_HEIGHT = 64;
+		static const unsigned int OBSERVATION_SIZE = OBSERVATION_WIDTH * OBSERVATION_HEIGHT;
+
+	private:
+		enum class Job
+		{
+			None,
+			Reset,
+			Step,
+			Quit
+		};
+
+		std::vector<std::unique_ptr<Machine>> machines;
+		std::unique_ptr<MachineState> initialState;
+		std::vector<RewardProbe> probes;
+		std::vector<uint8_t> observations;
+		std::vector<float> rewards;
+		std::vector<uint8_t> dones;
+		std::vector<uint32_t> episodeFrames;
+		const uint32_t* jobSeeds;
+		const uint16_t* jobActions;
+		unsigned int frameSkip;
+		unsigned int maxEpisodeFrames;
+
+		std::vector<std::thread> workers;
+		unsigned int threadCount;
+		std::mutex jobMutex;
+		std::condition_variable jobStarted;
+		std::condition_variable jobFinished;
+		Job job;
+		unsigned long long jobGeneration;
+		unsigned int workersBusy;
+
+		void workerLoop(unsigned int worker);
+		void runJob(Job job);
+		void resetMachine(unsigned int index, uint32_t seed);
+		void stepMachine(unsigned int index, uint16_t keys);
+		double readProbes(const MachineState& state) const;
+		void writeObservation(unsigned int index);
+
+	public:
+		VectorEnv();
+		~VectorEnv();
+		bool create(const unsigned char* rom, unsigned int romSize, Profile profile, unsigned int count, unsigned int threads);
+		void setFrameSkip(unsigned int frameSkip);
+		void setMaxEpisodeFrames(unsigned int maxEpisodeFrames);
+		void setCyclesPerFrame(unsigned int cyclesPerFrame);
+		void addProbe(const RewardProbe& probe);
+		void reset(const uint32_t* seeds);
+		void step(const uint16_t* actions);
+		unsigned int getCount() const;
+		const uint8_t* getObservations() const;
+		const float* getRewards() const;
+		const uint8_t* getDones() const;
+		Machine& getMachine(unsigned int index);
+	};
+}
+
+#endif //EMU_8_VECTORENV_H
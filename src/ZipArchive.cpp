@@ -0,0 +1,157 @@
+#include "ZipArchive.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "Console.h"
+
+namespace Emu8
+{
+	namespace
+	{
+		const uint32_t END_OF_DIRECTORY_SIGNATURE = 0x06054B50;
+		const uint32_t DIRECTORY_ENTRY_SIGNATURE = 0x02014B50;
+		const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+		const size_t END_OF_DIRECTORY_SIZE = 22;
+		const size_t DIRECTORY_ENTRY_SIZE = 46;
+		const size_t LOCAL_HEADER_SIZE = 30;
+		const uint16_t STORED = 0;
+		const uint16_t DEFLATED = 8;
+	}
+
+	bool ZipArchive::open(std::string filePath)
+	{
+		data.clear();
+		entries.clear();
+
+		std::ifstream in(filePath, std::ios::binary);
+		if(!in)
+		{
+			Console::Print("Could not open " + filePath + ".");
+			return false;
+		}
+		data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+		//The end of directory record sits at the very end, followed only by a comment of up to 64KB.
+		size_t end = 0;
+		bool found = false;
+		if(data.size() >= END_OF_DIRECTORY_SIZE)
+		{
+			size_t last = data.size() - END_OF_DIRECTORY_SIZE;
+			size_t first = last > 65535 ? last - 65535 : 0;
+			for(size_t offset = last + 1; offset > first && !found; offset--)
+			{
+				found = read32(offset - 1) == END_OF_DIRECTORY_SIGNATURE;
+				end = offset - 1;
+			}
+		}
+		if(!found)
+		{
+			Console::Print(filePath + " is not a zip archive.");
+			return false;
+		}
+
+		unsigned int count = read16(end + 10);
+		size_t offset = read32(end + 16);
+		for(unsigned int i = 0; i < count; i++)
+		{
+			if(offset + DIRECTORY_ENTRY_SIZE > data.size() || read32(offset) != DIRECTORY_ENTRY_SIGNATURE)
+			{
+				Console::Print(filePath + " has a broken central directory.");
+				return false;
+			}
+
+			ZipEntry entry;
+			size_t nameLength = read16(offset + 28);
+			entry.method = read16(offset + 10);
+			entry.crc = read32(offset + 16);
+			entry.compressedSize = read32(offset + 20);
+			entry.size = read32(offset + 24);
+			entry.localHeaderOffset = read32(offset + 42);
+			if(offset + DIRECTORY_ENTRY_SIZE + nameLength > data.size())
+			{
+				return false;
+			}
+			entry.name.assign((const char*)&data[offset + DIRECTORY_ENTRY_SIZE], nameLength);
+
+			offset += DIRECTORY_ENTRY_SIZE + nameLength + read16(offset + 30) + read16(offset + 32);
+
+			//Directories are entries of their own, with a name ending in a slash.
+			if(!entry.name.empty() && entry.name.back() != '/')
+			{
+				entries.push_back(entry);
+			}
+		}
+
+		return true;
+	}
+
+	const std::vector<ZipEntry>& ZipArchive::getEntries() const
+	{
+		return entries;
+	}
+
+	bool ZipArchive::extract(const ZipEntry& entry, std::vector<unsigned char>& contents) const
+	{
+		size_t header = entry.localHeaderOffset;
+		if(header + LOCAL_HEADER_SIZE > data.size() || read32(header) != LOCAL_HEADER_SIGNATURE)
+		{
+			return false;
+		}
+
+		//The local header repeats the name but may carry a different extra field, so its own lengths are used.
+		size_t start = header + LOCAL_HEADER_SIZE + read16(header + 26) + read16(header + 28);
+		if(start + entry.compressedSize > data.size())
+		{
+			return false;
+		}
+
+		contents.resize(entry.size);
+		if(entry.method == STORED)
+		{
+			if(entry.compressedSize != entry.size)
+			{
+				return false;
+			}
+			std::copy(data.begin() + start, data.begin() + start + entry.size, contents.begin());
+		}
+		else if(entry.method == DEFLATED)
+		{
+			//Raw deflate, without the zlib header.
+			z_stream stream = z_stream();
+			if(inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+			{
+				return false;
+			}
+			stream.next_in = (Bytef*)&data[start];
+			stream.avail_in = entry.compressedSize;
+			stream.next_out = contents.data();
+			stream.avail_out = entry.size;
+			int result = inflate(&stream, Z_FINISH);
+			inflateEnd(&stream);
+
+			if(result != Z_STREAM_END || stream.total_out != entry.size)
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+
+		return crc32(0, contents.data(), (uInt)contents.size()) == entry.crc;
+	}
+
+	uint16_t ZipArchive::read16(size_t offset) const
+	{
+		return offset + 2 <= data.size() ? (uint16_t)(data[offset] | (data[offset + 1] << 8)) : 0;
+	}
+
+	uint32_t ZipArchive::read32(size_t offset) const
+	{
+		return offset + 4 <= data.size() ? (uint32_t)(read16(offset) | ((uint32_t)read16(offset + 2) << 16)) : 0;
+	}
+}
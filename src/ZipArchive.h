@@ -0,0 +1,39 @@
+#ifndef EMU_8_ZIPARCHIVE_H
+#define EMU_8_ZIPARCHIVE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Emu8
+{
+	struct ZipEntry
+	{
+		std::string name;
+		uint16_t method;
+		uint32_t crc;
+		uint32_t compressedSize;
+		uint32_t size;
+		uint32_t localHeaderOffset;
+	};
+
+	//Reads the files out of a zip archive such as the game pack, held in memory as a whole. Entries are either
+	//stored or deflated, which is all zip tools write for files this small, and are checked against their CRC.
+	//Needs zlib, so it is only built into the tools that read archives.
+	class ZipArchive
+	{
+	private:
+		std::vector<unsigned char> data;
+		std::vector<ZipEntry> entries;
+
+		uint16_t read16(size_t offset) const;
+		uint32_t read32(size_t offset) const;
+
+	public:
+		bool open(std::string filePath);
+		const std::vector<ZipEntry>& getEntries() const;
+		bool extract(const ZipEntry& entry, std::vector<unsigned char>& contents) const;
+	};
+}
+
+#endif //EMU_8_ZIPARCHIVE_H
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Console.h"
+#include "Disassembler.h"
+#include "Hash.h"
+#include "Quirks.h"
+#include "RomAnalysis.h"
+#include "ZipArchive.h"
+
+//Analyses ROMs without running them and writes a JSON report to stdout: the control flow graph, what each ROM needs
+//from the interpreter (profile, self-modifying code, indirect jumps) and the idle loops it will spend its time in.
+//ROMs are given as files or as zip archives such as the game pack, and are analysed in parallel.
+//
+//Usage: emu8_analyze [--disassemble] [--threads n] [--profile name] <rom or zip>...
+
+namespace
+{
+	struct Job
+	{
+		std::string name;
+		std::vector<unsigned char> rom;
+		std::string json;
+	};
+
+	std::string Quote(const std::string& text)
+	{
+		std::string quoted = "\"";
+		for(char character : text)
+		{
+			if(character == '"' || character == '\\')
+			{
+				quoted += '\\';
+				quoted += character;
+			}
+			else if((unsigned char)character < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned int)(unsigned char)character);
+				quoted += escaped;
+			}
+			else
+			{
+				quoted += character;
+			}
+		}
+		return quoted + "\"";
+	}
+
+	std::string Address(unsigned int address)
+	{
+		char text[16];
+		std::snprintf(text, sizeof(text), "\"0x%03X\"", address);
+		return text;
+	}
+
+	template<typename Addresses>
+	std::string AddressList(const Addresses& addresses)
+	{
+		std::string list = "[";
+		for(auto address = addresses.begin(); address != addresses.end(); ++address)
+		{
+			list += (address == addresses.begin() ? "" : ", ") + Address(*address);
+		}
+		return list + "]";
+	}
+
+	std::string Flag(bool value)
+	{
+		return value ? "true" : "false";
+	}
+
+	std::string ToJson(const std::string& name, const Emu8::RomAnalysis& analysis, bool disassemble)
+	{
+		const Emu8::RomReport& report = analysis.getReport();
+		const Emu8::ControlFlow& controlFlow = analysis.getControlFlow();
+		bool selfModifying = !report.codeWrites.empty();
+		bool idleLoops = !report.timerWaitLoops.empty() || !report.keyWaitLoops.empty() || !report.spinLoops.empty();
+
+		std::string json = "{\n";
+		json += "\t\t\t\"name\": " + Quote(name) + ",\n";
+		json += "\t\t\t\"size\": " + std::to_string(report.romSize) + ",\n";
+		json += "\t\t\t\"hash\": \"" + Emu8::Hash::ToHex(report.romHash) + "\",\n";
+		json += "\t\t\t\"profile\": " + Quote(Emu8::Profiles::GetName(report.profile)) + ",\n";
+		json += "\t\t\t\"suggestedProfile\": " + Quote(Emu8::Profiles::GetName(report.suggestedProfile)) + ",\n";
+		json += "\t\t\t\"instructions\": " + std::to_string(report.instructionCount) + ",\n";
+		json += "\t\t\t\"blocks\": " + std::to_string(controlFlow.getBlocks().size()) + ",\n";
+		json += "\t\t\t\"subroutines\": " + std::to_string(report.subroutineCount) + ",\n";
+		json += "\t\t\t\"hiRes\": " + Flag(report.hiRes) + ",\n";
+		json += "\t\t\t\"selfModifying\": " + Flag(selfModifying) + ",\n";
+		json += "\t\t\t\"codeWrites\": " + AddressList(report.codeWrites) + ",\n";
+		json += "\t\t\t\"unknownStores\": " + AddressList(report.unknownStores) + ",\n";
+		json += "\t\t\t\"indirectJumps\": " + AddressList(report.indirectJumps) + ",\n";
+		json += "\t\t\t\"superChipInstructions\": " + AddressList(report.superChipInstructions) + ",\n";
+		json += "\t\t\t\"xoChipInstructions\": " + AddressList(report.xoChipInstructions) + ",\n";
+		json += "\t\t\t\"timerWaitLoops\": " + AddressList(report.timerWaitLoops) + ",\n";
+		json += "\t\t\t\"keyWaitLoops\": " + AddressList(report.keyWaitLoops) + ",\n";
+		json += "\t\t\t\"spinLoops\": " + AddressList(report.spinLoops) + ",\n";
+
+		//Translated code is only safe where nothing writes over it and every jump target is known up front, and
+		//skipping idle loops only pays off where there are some.
+		json += "\t\t\t\"fastPaths\": {\"idleLoopSkipping\": " + Flag(idleLoops) + ", \"aheadOfTime\": " + Flag(!selfModifying && report.unknownStores.empty() && report.indirectJumps.empty()) + "},\n";
+
+		json += "\t\t\t\"cfg\": [";
+		bool firstBlock = true;
+		for(const auto& entry : controlFlow.getBlocks())
+		{
+			const Emu8::BasicBlock& block = entry.second;
+			json += firstBlock ? "\n" : ",\n";
+			json += "\t\t\t\t{\"start\": " + Address(block.start) + ", \"end\": " + Address(block.end) + ", \"successors\": " + AddressList(block.successors) + ", \"indirect\": " + Flag(block.indirectJump);
+			firstBlock = false;
+
+			if(disassemble)
+			{
+				json += ", \"disassembly\": [";
+				unsigned int address = block.start;
+				for(unsigned int i = 0; i < block.instructionCount; i++)
+				{
+					std::string line = Emu8::Disassembler::Disassemble(controlFlow.getInstruction(address), controlFlow.getInstruction(address + 2));
+					json += (i == 0 ? "" : ", ") + Quote(line);
+					address += controlFlow.getInstructionLength(address);
+				}
+				json += "]";
+			}
+			json += "}";
+		}
+		json += firstBlock ? "]\n" : "\n\t\t\t]\n";
+
+		return json + "\t\t}";
+	}
+
+	bool ReadFile(const std::string& filePath, std::vector<unsigned char>& contents)
+	{
+		std::ifstream in(filePath, std::ios::binary);
+		if(!in)
+		{
+			return false;
+		}
+		contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+		return true;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Emu8::Console::SetEnabled(true);
+
+	bool disassemble = false;
+	bool profileGiven = false;
+	Emu8::Profile profile = Emu8::Profile::CosmacVip;
+	unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<Job> jobs;
+
+	for(int i = 1; i < argc; i++)
+	{
+		std::string argument = args[i];
+		if(argument == "--disassemble")
+		{
+			disassemble = true;
+		}
+		else if(argument == "--threads" && i + 1 < argc)
+		{
+			threadCount = std::max(1, std::atoi(args[++i]));
+		}
+		else if(argument == "--profile" && i + 1 < argc)
+		{
+			if(!Emu8::Profiles::Parse(args[++i], profile))
+			{
+				Emu8::Console::Print("Unknown quirk profile " + std::string(args[i]) + ".");
+				return 1;
+			}
+			profileGiven = true;
+		}
+		else if(argument.size() > 4 && argument.compare(argument.size() - 4, 4, ".zip") == 0)
+		{
+			Emu8::ZipArchive archive;
+			if(!archive.open(argument))
+			{
+				return 1;
+			}
+			for(const Emu8::ZipEntry& entry : archive.getEntries())
+			{
+				Job job = {argument + ":" + entry.name, std::vector<unsigned char>(), std::string()};
+				if(!archive.extract(entry, job.rom))
+				{
+					Emu8::Console::Print("Could not extract " + job.name + ".");
+					return 1;
+				}
+				jobs.push_back(std::move(job));
+			}
+		}
+		else
+		{
+			Job job = {argument, std::vector<unsigned char>(), std::string()};
+			if(!ReadFile(argument, job.rom))
+			{
+				Emu8::Console::Print("Could not open " + argument + ".");
+				return 1;
+			}
+			jobs.push_back(std::move(job));
+		}
+	}
+
+	if(jobs.empty())
+	{
+		Emu8::Console::Print("Usage: emu8_analyze [--disassemble] [--threads n] [--profile name] <rom or zip>...");
+		return 1;
+	}
+
+	//Each worker takes the next ROM until there are none left, the reports come out in the order they were given.
+	std::atomic<unsigned int> next(0);
+	auto work = [&]()
+	{
+		for(unsigned int index = next++; index < jobs.size(); index = next++)
+		{
+			Job& job = jobs[index];
+			Emu8::RomAnalysis analysis(profileGiven ? profile : Emu8::Profiles::FromFileName(job.name));
+			job.json = analysis.analyze(job.rom.data(), (unsigned int)job.rom.size()) ? ToJson(job.name, analysis, disassemble) : "{\"name\": " + Quote(job.name) + ", \"error\": \"too big to load\"}";
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for(unsigned int i = 1; i < std::min(threadCount, (unsigned int)jobs.size()); i++)
+	{
+		workers.push_back(std::thread(work));
+	}
+	work();
+	for(std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	std::cout << "{\n\t\"roms\": [\n";
+	for(unsigned int i = 0; i < jobs.size(); i++)
+	{
+		std::cout << "\t\t" << jobs[i].json << (i + 1 < jobs.size() ? ",\n" : "\n");
+	}
+	std::cout << "\t]\n}\n";
+
+	return 0;
+}
@@ -0,0 +1,457 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AnalysisCache.h"
+#include "AotModule.h"
+#include "Console.h"
+#include "ControlFlow.h"
+#include "Hash.h"
+#include "Machine.h"
+#include "Quirks.h"
+
+namespace Emu8
+{
+	//Writes a C++ translation unit with one function per basic block of a ROM. Arithmetic, loads, jumps and skips
+	//are emitted inline with the quirks of the profile baked in, anything else goes back through the interpreter.
+	template<typename Quirks>
+	class Translator
+	{
+	private:
+		const Machine& machine;
+		const ControlFlow& controlFlow;
+		std::ostream& out;
+
+		static std::string Hex(unsigned int value, int digits)
+		{
+			std::ostringstream text;
+			text << "0x";
+			text.width(digits);
+			text.fill('0');
+			text << std::hex << std::uppercase << value;
+			return text.str();
+		}
+
+		static std::string Register(unsigned int index)
+		{
+			return "s.vReg[" + Hex(index, 1) + "]";
+		}
+
+		static std::string BlockName(unsigned short address)
+		{
+			return "block_" + Hex(address, 4).substr(2);
+		}
+
+		bool isStore(unsigned short instruction) const
+		{
+			return (instruction & 0xF0FF) == 0xF033 || (instruction & 0xF0FF) == 0xF055 || (Quirks::xoChipInstructions && (instruction & 0xF00F) == 0x5002);
+		}
+
+		std::string getSkipCondition(unsigned short instruction) const
+		{
+			unsigned int x = (instruction >> 8) & 0xF;
+			unsigned int y = (instruction >> 4) & 0xF;
+			unsigned int kk = instruction & 0xFF;
+
+			switch(instruction >> 12)
+			{
+				case 0x3:
+					return Register(x) + " == " + Hex(kk, 2);
+				case 0x4:
+					return Register(x) + " != " + Hex(kk, 2);
+				case 0x5:
+					return Register(x) + " == " + Register(y);
+				case 0x9:
+					return Register(x) + " != " + Register(y);
+				default:
+					return std::string(kk == 0x9E ? "" : "!") + "s.keys[" + Register(x) + " & 0xF]";
+			}
+		}
+
+		//Emits the inline form of an instruction that does not end a block, or returns false if it has none.
+		bool emitInline(unsigned short instruction)
+		{
+			unsigned int x = (instruction >> 8) & 0xF;
+			unsigned int y = (instruction >> 4) & 0xF;
+			unsigned int kk = instruction & 0xFF;
+			std::string vx = Register(x);
+			std::string vy = Register(y);
+			std::string vf = Register(0xF);
+
+			switch(instruction >> 12)
+			{
+				case 0x6:
+					out << "\t\t" << vx << " = " << Hex(kk, 2) << ";\n";
+					return true;
+				case 0x7:
+					out << "\t\t" << vx << " = (unsigned char)(" << vx << " + " << Hex(kk, 2) << ");\n";
+					return true;
+				case 0xA:
+					out << "\t\ts.iRegister = " << Hex(instruction & 0xFFF, 3) << ";\n";
+					return true;
+				case 0x8:
+				{
+					std::string source = Quirks::shiftUsesVy ? vy : vx;
+
+					switch(instruction & 0xF)
+					{
+						case 0x0:
+							out << "\t\t" << vx << " = " << vy << ";\n";
+							return true;
+						case 0x1:
+						case 0x2:
+						case 0x3:
+						{
+							const char* operators[] = {"", "|", "&", "^"};
+							out << "\t\t" << vx << " = " << vx << " " << operators[instruction & 0xF] << " " << vy << ";\n";
+							if(Quirks::logicResetsVf)
+							{
+								out << "\t\t" << vf << " = 0;\n";
+							}
+							return true;
+						}
+						case 0x4:
+							out << "\t\t" << vf << " = " << vx << " > (255 - " << vy << ") ? 1 : 0;\n";
+							out << "\t\t" << vx << " = (unsigned char)(" << vx << " + " << vy << ");\n";
+							return true;
+						case 0x5:
+							out << "\t\t" << vf << " = " << vx << " > " << vy << " ? 1 : 0;\n";
+							out << "\t\t" << vx << " = (unsigned char)(" << vx << " - " << vy << ");\n";
+							return true;
+						case 0x6:
+							out << "\t\t{\n\t\t\tunsigned char source = " << source << ";\n";
+							out << "\t\t\t" << vx << " = (unsigned char)(source / 2);\n";
+							out << "\t\t\t" << vf << " = source & 0x1 ? 1 : 0;\n\t\t}\n";
+							return true;
+						case 0x7:
+							out << "\t\t" << vf << " = " << vy << " > " << vx << " ? 1 : 0;\n";
+							out << "\t\t" << vx << " = (unsigned char)(" << vy << " - " << vx << ");\n";
+							return true;
+						case 0xE:
+							out << "\t\t{\n\t\t\tunsigned char source = " << source << ";\n";
+							out << "\t\t\t" << vx << " = (unsigned char)(source * 2);\n";
+							out << "\t\t\t" << vf << " = source & 0x80 ? 1 : 0;\n\t\t}\n";
+							return true;
+						default:
+							return false;
+					}
+				}
+				case 0xF:
+				{
+					switch(kk)
+					{
+						case 0x07:
+							out << "\t\t" << vx << " = s.delayRegister;\n";
+							return true;
+						case 0x15:
+							out << "\t\ts.delayRegister = " << vx << ";\n";
+							return true;
+						case 0x18:
+							out << "\t\ts.soundRegister = " << vx << ";\n";
+							return true;
+						case 0x1E:
+							out << "\t\ts.iRegister = (unsigned short)(s.iRegister + " << vx << ");\n";
+							return true;
+						case 0x29:
+							out << "\t\ts.iRegister = (unsigned short)(" << vx << " * 5);\n";
+							return true;
+						default:
+							return false;
+					}
+				}
+				default:
+					return false;
+			}
+		}
+
+		void emitBlock(const BasicBlock& block)
+		{
+			out << "\tunsigned int " << BlockName(block.start) << "(AotContext* context)\n\t{\n";
+			out << "\t\tMachineState& s = *context->state;\n";
+
+			unsigned int address = block.start;
+			for(unsigned int count = 1; count <= block.instructionCount; count++)
+			{
+				unsigned short instruction = controlFlow.getInstruction(address);
+				unsigned int next = address + controlFlow.getInstructionLength(address);
+				bool last = count == block.instructionCount;
+
+				out << "\t\t//" << Hex(address, 4) << ": " << Hex(instruction, 4) << "\n";
+
+				if((instruction & 0xF000) == 0x1000)
+				{
+					unsigned int target = instruction & 0xFFF;
+					out << "\t\ts.programCounter = " << Hex(target, 4) << ";\n";
+					if(target <= address && address - target <= 4)
+					{
+						out << "\t\tcontext->idleCandidate = true;\n";
+					}
+					out << "\t\treturn " << count << ";\n";
+				}
+				else if(controlFlow.isSkip(instruction))
+				{
+					unsigned int skipTarget = next + controlFlow.getInstructionLength(next);
+					if((instruction & 0xF000) == 0xE000)
+					{
+						out << "\t\ts.keysPolled |= (uint16_t)(1 << (" << Register((instruction >> 8) & 0xF) << " & 0xF));\n";
+					}
+					out << "\t\ts.programCounter = " << getSkipCondition(instruction) << " ? " << Hex(skipTarget & 0xFFFF, 4) << " : " << Hex(next & 0xFFFF, 4) << ";\n";
+					out << "\t\treturn " << count << ";\n";
+				}
+				else if(emitInline(instruction))
+				{
+					if(last)
+					{
+						out << "\t\ts.programCounter = " << Hex(next & 0xFFFF, 4) << ";\n";
+						out << "\t\treturn " << count << ";\n";
+					}
+				}
+				else
+				{
+					out << "\t\ts.programCounter = " << Hex(address, 4) << ";\n";
+					out << "\t\tcontext->interpret(context->machine, " << Hex(instruction, 4) << ");\n";
+					if(last)
+					{
+						out << "\t\treturn " << count << ";\n";
+					}
+					else if(isStore(instruction))
+					{
+						out << "\t\tif(s.codeModified)\n\t\t{\n\t\t\treturn " << count << ";\n\t\t}\n";
+					}
+				}
+
+				address = next;
+			}
+
+			out << "\t}\n\n";
+		}
+
+	public:
+		Translator(const Machine& machine, const ControlFlow& controlFlow, std::ostream& out)
+				: machine(machine), controlFlow(controlFlow), out(out)
+		{
+		}
+
+		void emitModule(std::string romName)
+		{
+			const std::map<unsigned short, BasicBlock>& blocks = controlFlow.getBlocks();
+			unsigned int codeStart = Machine::PROGRAM_START;
+			unsigned int codeEnd = codeStart + machine.getRomSize();
+
+			out << "//Generated by emu8_aot from " << romName << " for the " << Profiles::GetName(Quirks::profile) << " profile, do not edit.\n";
+			out << "#include \"AotAbi.h\"\n\nusing namespace Emu8;\n\nnamespace\n{\n";
+
+			//One bit for every byte of translated code, so the core can tell when the program writes over it.
+			std::vector<unsigned char> codeMap((codeEnd - codeStart + 7) / 8 + 1, 0);
+			for(std::map<unsigned short, BasicBlock>::const_iterator block = blocks.begin(); block != blocks.end(); ++block)
+			{
+				for(unsigned int address = block->second.start; address != block->second.end; address++)
+				{
+					unsigned int offset = (address & 0xFFFF) - codeStart;
+					if(offset < codeEnd - codeStart)
+					{
+						codeMap[offset / 8] |= (unsigned char)(1 << (offset % 8));
+					}
+				}
+			}
+
+			out << "\tconst unsigned char codeMap[" << codeMap.size() << "] =\n\t\t\t{";
+			for(size_t i = 0; i < codeMap.size(); i++)
+			{
+				out << (i % 16 == 0 ? "\n\t\t\t\t\t" : " ") << Hex(codeMap[i], 2) << (i + 1 < codeMap.size() ? "," : "");
+			}
+			out << "\n\t\t\t};\n\n";
+
+			for(std::map<unsigned short, BasicBlock>::const_iterator block = blocks.begin(); block != blocks.end(); ++block)
+			{
+				emitBlock(block->second);
+			}
+
+			out << "\tunsigned int run(AotContext* context, unsigned int cyclesLeft)\n\t{\n";
+			out << "\t\tswitch(context->state->programCounter)\n\t\t{\n";
+			for(std::map<unsigned short, BasicBlock>::const_iterator block = blocks.begin(); block != blocks.end(); ++block)
+			{
+				out << "\t\t\tcase " << Hex(block->first, 4) << ":\n";
+				out << "\t\t\t\treturn cyclesLeft >= " << block->second.instructionCount << " ? " << BlockName(block->first) << "(context) : 0;\n";
+			}
+			out << "\t\t\tdefault:\n\t\t\t\treturn 0;\n\t\t}\n\t}\n\n";
+
+			out << "\tconst AotModuleInfo moduleInfo =\n\t\t\t{\n";
+			out << "\t\t\t\t\tEMU8_AOT_ABI_VERSION,\n";
+			out << "\t\t\t\t\t" << Hex((unsigned int)(machine.getRomHash() >> 32), 8) << "ULL << 32 | " << Hex((unsigned int)machine.getRomHash(), 8) << "ULL,\n";
+			out << "\t\t\t\t\tProfile::" << GetProfileEnumerator() << ",\n";
+			out << "\t\t\t\t\t" << Hex(codeStart, 4) << ",\n";
+			out << "\t\t\t\t\t" << Hex(codeEnd, 4) << ",\n";
+			out << "\t\t\t\t\tcodeMap,\n";
+			out << "\t\t\t\t\t&run\n";
+			out << "\t\t\t};\n}\n\n";
+
+			out << "EMU8_AOT_EXPORT const AotModuleInfo* " << EMU8_AOT_ENTRY_POINT << "()\n{\n\treturn &moduleInfo;\n}\n";
+		}
+
+		static std::string GetProfileEnumerator()
+		{
+			switch(Quirks::profile)
+			{
+				case Profile::Chip48:
+					return "Chip48";
+				case Profile::SuperChip:
+					return "SuperChip";
+				case Profile::XoChip:
+					return "XoChip";
+				default:
+					return "CosmacVip";
+			}
+		}
+	};
+
+	template<typename Quirks>
+	void Translate(const Machine& machine, const ControlFlow& controlFlow, std::ostream& out, std::string romName)
+	{
+		Translator<Quirks>(machine, controlFlow, out).emitModule(romName);
+	}
+
+	//Runs the interpreter and the translated module side by side on the same scripted input and compares the
+	//framebuffers after every frame.
+	bool Verify(std::string romPath, std::string modulePath, Profile profile, unsigned int frames)
+	{
+		std::unique_ptr<Machine> reference = Machine::Create(profile);
+		std::unique_ptr<Machine> translated = Machine::Create(profile);
+
+		if(!reference->loadGame(romPath) || !translated->loadGame(romPath))
+		{
+			return false;
+		}
+		if(!translated->loadAotModule(modulePath))
+		{
+			Console::Print("Could not load " + modulePath + ".");
+			return false;
+		}
+
+		unsigned int inputSeed = 12345;
+		for(unsigned int frame = 0; frame < frames; frame++)
+		{
+			if(frame % 8 == 0)
+			{
+				inputSeed = inputSeed * 1103515245 + 12345;
+				for(unsigned char key = 0; key < 16; key++)
+				{
+					bool pressed = ((inputSeed >> 16) & 0xF) == key;
+					reference->setKey(key, pressed);
+					translated->setKey(key, pressed);
+				}
+			}
+			if(reference->isWaitingForKey())
+			{
+				reference->provideKey((unsigned char)(frame & 0xF));
+			}
+			if(translated->isWaitingForKey())
+			{
+				translated->provideKey((unsigned char)(frame & 0xF));
+			}
+
+			reference->runFrame();
+			translated->runFrame();
+
+			const Framebuffer& expected = reference->getState().framebuffer;
+			const Framebuffer& actual = translated->getState().framebuffer;
+			uint64_t expectedHash = Hash::Fnv1a(expected.getRow(0, 0), sizeof(uint64_t) * Framebuffer::MAX_HEIGHT * Framebuffer::WORDS_PER_ROW);
+			uint64_t actualHash = Hash::Fnv1a(actual.getRow(0, 0), sizeof(uint64_t) * Framebuffer::MAX_HEIGHT * Framebuffer::WORDS_PER_ROW);
+			expectedHash = Hash::Fnv1a(expected.getRow(1, 0), sizeof(uint64_t) * Framebuffer::MAX_HEIGHT * Framebuffer::WORDS_PER_ROW, expectedHash);
+			actualHash = Hash::Fnv1a(actual.getRow(1, 0), sizeof(uint64_t) * Framebuffer::MAX_HEIGHT * Framebuffer::WORDS_PER_ROW, actualHash);
+
+			if(expectedHash != actualHash || reference->getState().programCounter != translated->getState().programCounter)
+			{
+				Console::Print("Mismatch at frame " + std::to_string(frame) + ": framebuffer " + Hash::ToHex(expectedHash) + " != " + Hash::ToHex(actualHash) + ".");
+				return false;
+			}
+		}
+
+		Console::Print("Framebuffers match for " + std::to_string(frames) + " frames.");
+		return true;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	if(argc >= 4 && std::string(args[1]) == "--verify")
+	{
+		Emu8::Profile profile = Emu8::Profiles::FromFileName(args[2]);
+		if(argc > 4 && !Emu8::Profiles::Parse(args[4], profile))
+		{
+			Emu8::Console::Print("Unknown quirk profile " + std::string(args[4]) + ".");
+			return 1;
+		}
+		unsigned int frames = argc > 5 ? (unsigned int)std::atoi(args[5]) : 3600;
+
+		return Emu8::Verify(args[2], args[3], profile, frames) ? 0 : 1;
+	}
+
+	if(argc < 3)
+	{
+		Emu8::Console::Print("Usage: emu8_aot <rom> <output.cpp> [profile]");
+		Emu8::Console::Print("       emu8_aot --verify <rom> <module> [profile] [frames]");
+		return 1;
+	}
+
+	std::string romPath = args[1];
+	Emu8::Profile profile = Emu8::Profiles::FromFileName(romPath);
+	if(argc > 3 && !Emu8::Profiles::Parse(args[3], profile))
+	{
+		Emu8::Console::Print("Unknown quirk profile " + std::string(args[3]) + ".");
+		return 1;
+	}
+
+	std::unique_ptr<Emu8::Machine> machine = Emu8::Machine::Create(profile);
+	if(!machine->loadGame(romPath))
+	{
+		return 1;
+	}
+
+	//With EMU8_CACHE_DIR the analysis is taken from the cache when there is a valid entry and added to it when not.
+	Emu8::ControlFlow controlFlow(profile);
+	const unsigned char* memory = machine->getState().mainMem.data();
+	unsigned int codeEnd = Emu8::Machine::PROGRAM_START + machine->getRomSize();
+	const char* cacheDirectory = std::getenv("EMU8_CACHE_DIR");
+	std::string cachePath = cacheDirectory == nullptr ? "" : std::string(cacheDirectory) + "/" + Emu8::AnalysisCache::GetFileName(machine->getRomHash(), profile);
+	Emu8::AnalysisCache cache;
+	if(cacheDirectory != nullptr && cache.open(cachePath, machine->getRomHash(), machine->getRomSize(), profile))
+	{
+		controlFlow.load(memory, Emu8::Machine::PROGRAM_START, codeEnd, cache);
+		Emu8::Console::Print("Using the cached analysis in " + cachePath + ".");
+	}
+	else
+	{
+		controlFlow.analyze(memory, Emu8::Machine::PROGRAM_START, codeEnd);
+		if(cacheDirectory != nullptr && Emu8::AnalysisCache::Write(cachePath, machine->getRomHash(), machine->getRomSize(), controlFlow, std::vector<unsigned short>()))
+		{
+			Emu8::Console::Print("Cached the analysis in " + cachePath + ".");
+		}
+	}
+	cache.close();
+
+	std::ofstream out(args[2]);
+	switch(profile)
+	{
+		case Emu8::Profile::Chip48:
+			Emu8::Translate<Emu8::Chip48Quirks>(*machine, controlFlow, out, romPath);
+			break;
+		case Emu8::Profile::SuperChip:
+			Emu8::Translate<Emu8::SuperChipQuirks>(*machine, controlFlow, out, romPath);
+			break;
+		case Emu8::Profile::XoChip:
+			Emu8::Translate<Emu8::XoChipQuirks>(*machine, controlFlow, out, romPath);
+			break;
+		default:
+			Emu8::Translate<Emu8::CosmacVipQuirks>(*machine, controlFlow, out, romPath);
+			break;
+	}
+
+	Emu8::Console::Print("Translated " + std::to_string(controlFlow.getBlocks().size()) + " blocks into " + args[2] + ".");
+	Emu8::Console::Print("Build it as a shared library named " + Emu8::AotModule::GetFileName(machine->getRomHash()) + " and put it in EMU8_AOT_DIR or EMU8_CACHE_DIR.");
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "AllocationCounter.h"
+#include "Console.h"
+#include "Machine.h"
+#include "Phosphor.h"
+#include "Quirks.h"
+
+//Runs a ROM headless as fast as it goes and reports what a frame costs, split into emulation and the stages the
+//frontend runs after it.
+//
+//In builds that count allocations the frame loop has to run without allocating once it is warmed up, the exit code
+//says whether it did.
+//
+//Usage: emu8_bench <rom> [frames] [phosphor decay frames]
+
+namespace
+{
+	std::string FormatMicroseconds(double total, unsigned long long frames)
+	{
+		return std::to_string(frames > 0 ? total / frames : 0.0) + "us per frame";
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Emu8::Console::SetEnabled(true);
+
+	if(argc < 2)
+	{
+		Emu8::Console::Print("Usage: emu8_bench <rom> [frames] [phosphor decay frames]");
+		return 1;
+	}
+
+	std::string romPath = args[1];
+	unsigned long long frames = argc > 2 ? std::strtoull(args[2], nullptr, 10) : 10000;
+	unsigned int decayFrames = argc > 3 ? (unsigned int)std::atoi(args[3]) : 8;
+
+	std::unique_ptr<Emu8::Machine> machine = Emu8::Machine::Create(Emu8::Profiles::FromFileName(romPath));
+	if(!machine->loadGame(romPath))
+	{
+		return 1;
+	}
+	Emu8::Console::SetEnabled(false);
+
+	Emu8::Phosphor phosphor;
+	phosphor.setDecayFrames(decayFrames);
+
+	double emulation = 0;
+	double composition = 0;
+	unsigned long long rowsBlended = 0;
+	unsigned long long allocations = 0;
+
+	unsigned long long frame = 0;
+	for(; frame < frames && !machine->isHalted(); frame++)
+	{
+		unsigned long long allocationsBefore = Emu8::AllocationCounter::GetCount();
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		machine->runFrame();
+		emulation += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+		phosphor.compose(machine->getState().framebuffer);
+		composition += phosphor.getLastCost();
+		rowsBlended += phosphor.getRowsBlended();
+
+		//The first frame may still set things up.
+		if(frame > 0)
+		{
+			allocations += Emu8::AllocationCounter::GetCount() - allocationsBefore;
+		}
+	}
+
+	frames = frame;
+
+	Emu8::Console::SetEnabled(true);
+	Emu8::Console::Print("Frames: " + std::to_string(frames));
+	Emu8::Console::Print("Emulation: " + FormatMicroseconds(emulation, frames));
+	Emu8::Console::Print("Phosphor (" + std::to_string(decayFrames) + " frame decay): " + FormatMicroseconds(composition, frames) + ", " + std::to_string(frames > 0 ? (double)rowsBlended / frames : 0.0) + " rows blended per frame");
+
+	if(Emu8::AllocationCounter::IsEnabled())
+	{
+		Emu8::Console::Print("Allocations in the frame loop: " + std::to_string(allocations));
+		return allocations == 0 ? 0 : 1;
+	}
+	return 0;
+}
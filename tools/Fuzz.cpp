@@ -0,0 +1,154 @@
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "Console.h"
+#include "Machine.h"
+#include "Quirks.h"
+
+//Fuzzing harness for the emulation core. Built with EMU8_LIBFUZZER it is a libFuzzer target, otherwise main() replays
+//the inputs given on the command line, or measures executions per second with --bench.
+//
+//Input layout: byte 0 picks the quirk profile, bytes 1 and 2 are the keypad state, the rest is loaded as the ROM.
+
+namespace Emu8
+{
+	class FuzzHarness
+	{
+	private:
+		std::array<std::unique_ptr<Machine>, 4> machines;
+		std::vector<MachineState> snapshots;
+
+	public:
+		static const unsigned int FRAMES_PER_INPUT = 4;
+		static const unsigned int CYCLES_PER_FRAME = 128;
+
+		FuzzHarness(unsigned char* coverageMap, unsigned int coverageSize)
+				: machines(), snapshots(4)
+		{
+			const Profile profiles[] = {Profile::CosmacVip, Profile::Chip48, Profile::SuperChip, Profile::XoChip};
+
+			//Prepare one machine per profile and snapshot it, every input then starts from a cheap reset instead of
+			//constructing a new machine.
+			for(unsigned int i = 0; i < machines.size(); i++)
+			{
+				machines[i] = Machine::Create(profiles[i]);
+				machines[i]->setCyclesPerFrame(CYCLES_PER_FRAME);
+				machines[i]->setCoverageMap(coverageMap, coverageSize);
+				machines[i]->saveState(snapshots[i]);
+			}
+		}
+
+		void run(const unsigned char* data, size_t size)
+		{
+			if(size < 3)
+			{
+				return;
+			}
+
+			unsigned int index = data[0] % machines.size();
+			Machine& machine = *machines[index];
+			machine.resetTo(snapshots[index]);
+
+			if(!machine.loadGame(data + 3, (unsigned int)(size - 3)))
+			{
+				return;
+			}
+
+			unsigned int keys = (unsigned int)(data[1] | (data[2] << 8));
+			for(unsigned char key = 0; key < 16; key++)
+			{
+				machine.setKey(key, (keys >> key) & 1);
+			}
+
+			for(unsigned int frame = 0; frame < FRAMES_PER_INPUT && !machine.isHalted(); frame++)
+			{
+				if(machine.isWaitingForKey())
+				{
+					machine.provideKey((unsigned char)frame);
+				}
+				machine.runFrame();
+			}
+		}
+	};
+}
+
+#ifdef EMU8_LIBFUZZER
+//Guest program counter coverage, libFuzzer treats every byte in this section as an extra feature counter.
+__attribute__((used, section("__libfuzzer_extra_counters"))) static unsigned char pcCoverage[4096];
+#else
+static unsigned char pcCoverage[4096];
+#endif
+
+static Emu8::FuzzHarness& GetHarness()
+{
+	static Emu8::FuzzHarness harness(pcCoverage, sizeof(pcCoverage));
+	return harness;
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+	Emu8::Console::SetEnabled(false);
+	GetHarness();
+	return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	GetHarness().run(data, size);
+	return 0;
+}
+
+#ifndef EMU8_LIBFUZZER
+int main(int argc, char* args[])
+{
+	LLVMFuzzerInitialize(&argc, &args);
+
+	if(argc > 1 && std::string(args[1]) == "--bench")
+	{
+		double seconds = argc > 2 ? std::stod(args[2]) : 5.0;
+		//Random inputs are generated up front so that only the harness itself is measured.
+		std::mt19937 random(1);
+		std::vector<std::vector<unsigned char> > inputs(1024, std::vector<unsigned char>(3 + 512));
+		for(std::vector<unsigned char>& input : inputs)
+		{
+			for(unsigned char& byte : input)
+			{
+				byte = (unsigned char)random();
+			}
+		}
+		unsigned long long executions = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::duration<double> elapsed(0);
+		while(elapsed.count() < seconds)
+		{
+			for(const std::vector<unsigned char>& input : inputs)
+			{
+				LLVMFuzzerTestOneInput(input.data(), input.size());
+				executions++;
+			}
+			elapsed = std::chrono::steady_clock::now() - start;
+		}
+
+		Emu8::Console::SetEnabled(true);
+		Emu8::Console::Print(std::to_string((unsigned long long)(executions / elapsed.count())) + " executions per second.");
+		return 0;
+	}
+
+	for(int i = 1; i < argc; i++)
+	{
+		std::ifstream file(args[i], std::ios::in | std::ios::binary);
+		std::vector<unsigned char> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		LLVMFuzzerTestOneInput(input.data(), input.size());
+	}
+
+	return 0;
+}
+#endif
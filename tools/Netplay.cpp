@@ -0,0 +1,126 @@
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "Console.h"
+#include "Hash.h"
+#include "Machine.h"
+#include "Quirks.h"
+#include "Rollback.h"
+#include "Transport.h"
+
+//Plays a ROM as two rollback peers connected in process, with the given latency in frames and packet loss, and
+//checks that both end up exactly where one machine fed the same keys directly does. Each peer holds one half of the
+//keypad and changes its keys at random every few frames, which makes for far more wrong guesses than a person would.
+//
+//Usage: emu8_netplay <rom> [frames] [latency frames] [max rollback frames] [drop every nth packet]
+
+namespace
+{
+	//Deterministic keys for a peer, on its own half of the keypad and held for 8 frames at a time.
+	uint16_t GetKeys(unsigned long long frame, unsigned int peer, unsigned long long frames)
+	{
+		if(frame >= frames)
+		{
+			return 0;
+		}
+
+		uint64_t segment = frame / 8;
+		uint64_t value = Emu8::Hash::Fnv1a(&segment, sizeof(segment), Emu8::Hash::FNV_OFFSET_BASIS + peer);
+		return (uint16_t)(value & (value >> 16) & (peer == 0 ? 0x00FF : 0xFF00));
+	}
+
+	uint64_t HashMachine(const Emu8::Machine& machine)
+	{
+		const Emu8::MachineState& state = machine.getState();
+		uint64_t hash = Emu8::Hash::Fnv1a(state.mainMem.data(), state.mainMem.size());
+		hash = Emu8::Hash::Fnv1a(state.vReg.data(), state.vReg.size(), hash);
+		hash = Emu8::Hash::Fnv1a(&state.framebuffer, sizeof(state.framebuffer), hash);
+		hash = Emu8::Hash::Fnv1a(&state.programCounter, sizeof(state.programCounter), hash);
+		return Emu8::Hash::Fnv1a(&state.iRegister, sizeof(state.iRegister), hash);
+	}
+
+	void PrintStats(std::string name, const Emu8::RollbackStats& stats)
+	{
+		double seconds = stats.frames / 60.0;
+		Emu8::Console::Print(name + ": " + std::to_string(stats.rollbacks) + " rollbacks (" + std::to_string(seconds > 0 ? stats.rollbacks / seconds : 0.0) + " per second), " + std::to_string(stats.rollbacks > 0 ? (double)stats.framesResimulated / stats.rollbacks : 0.0) + " frames and " + std::to_string(stats.rollbacks > 0 ? stats.resimulationTime / stats.rollbacks : 0.0) + "us per rollback, " + std::to_string(stats.stalls) + " stalls.");
+	}
+}
+
+int main(int argc, char* args[])
+{
+	Emu8::Console::SetEnabled(true);
+
+	if(argc < 2)
+	{
+		Emu8::Console::Print("Usage: emu8_netplay <rom> [frames] [latency frames] [max rollback frames] [drop every nth packet]");
+		return 1;
+	}
+
+	std::string romPath = args[1];
+	unsigned long long frames = argc > 2 ? std::strtoull(args[2], nullptr, 10) : 3600;
+	unsigned int latency = argc > 3 ? (unsigned int)std::atoi(args[3]) : 4;
+	unsigned int maxRollback = argc > 4 ? (unsigned int)std::atoi(args[4]) : 8;
+	unsigned int dropEvery = argc > 5 ? (unsigned int)std::atoi(args[5]) : 0;
+	Emu8::Profile profile = Emu8::Profiles::FromFileName(romPath);
+
+	std::unique_ptr<Emu8::Machine> machines[3];
+	for(std::unique_ptr<Emu8::Machine>& machine : machines)
+	{
+		machine = Emu8::Machine::Create(profile);
+		if(!machine->loadGame(romPath))
+		{
+			return 1;
+		}
+	}
+	Emu8::Console::SetEnabled(false);
+
+	Emu8::LoopbackTransport transports[2];
+	Emu8::LoopbackTransport::Connect(transports[0], transports[1]);
+	for(Emu8::LoopbackTransport& transport : transports)
+	{
+		transport.setLatency(latency);
+		transport.setDropEvery(dropEvery);
+	}
+
+	Emu8::Rollback peers[2] = {Emu8::Rollback(*machines[0], transports[0], maxRollback), Emu8::Rollback(*machines[1], transports[1], maxRollback)};
+
+	//Both halves of the keypad stay up for long enough at the end that the last guesses are right and every frame
+	//is confirmed, so all three machines have seen exactly the same keys.
+	unsigned long long total = frames + latency + maxRollback + 2;
+	while(peers[0].getFrame() < total || peers[1].getFrame() < total)
+	{
+		for(unsigned int peer = 0; peer < 2; peer++)
+		{
+			if(peers[peer].getFrame() < total)
+			{
+				peers[peer].advance(GetKeys(peers[peer].getFrame(), peer, frames));
+			}
+		}
+	}
+
+	for(unsigned long long frame = 0; frame < total; frame++)
+	{
+		uint16_t keys = GetKeys(frame, 0, frames) | GetKeys(frame, 1, frames);
+		uint16_t previous = frame > 0 ? (uint16_t)(GetKeys(frame - 1, 0, frames) | GetKeys(frame - 1, 1, frames)) : 0;
+		machines[2]->setKeys(keys);
+		if(machines[2]->isWaitingForKey() && (keys & ~previous) != 0)
+		{
+			unsigned char key = 0;
+			while(!((keys & ~previous) & (1 << key)))
+			{
+				key++;
+			}
+			machines[2]->provideKey(key);
+		}
+		machines[2]->runFrame();
+	}
+
+	Emu8::Console::SetEnabled(true);
+	PrintStats("Peer 1", peers[0].getStats());
+	PrintStats("Peer 2", peers[1].getStats());
+
+	uint64_t reference = HashMachine(*machines[2]);
+	bool match = HashMachine(*machines[0]) == reference && HashMachine(*machines[1]) == reference;
+	Emu8::Console::Print(match ? "Both peers match the reference after " + std::to_string(total) + " frames." : "Peers diverged from the reference!");
+	return match ? 0 : 1;
+}
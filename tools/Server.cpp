@@ -0,0 +1,632 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Console.h"
+#include "Machine.h"
+#include "Quirks.h"
+
+//Headless control server. Listens on a Unix domain socket and gives every connection its own machine, driven by a
+//compact binary protocol. One epoll loop serves all connections.
+//
+//Every message is a little endian u32 length followed by that many bytes, starting with the command byte:
+//
+//    request:  u32 length | u8 command | payload
+//    response: u32 length | u8 command | u8 status | payload
+//
+//Requests can be pipelined, responses come back in the order the requests were sent. Everything already read from a
+//connection is processed before replying, so a batch of requests costs one round trip. Every connection shares the one
+//thread, so a request runs at most 3600 frames, more is a bad request.
+//
+//    1 LoadRom        u8 profile (0 vip, 1 chip48, 2 schip, 3 xochip), ROM bytes
+//    2 SetKeys        u16 mask of held keys, bit n for key n
+//    3 RunFrames      u32 frames                              -> u8 flags (1 halted, 2 waiting for key), u64 instructions
+//    4 ReadMemory     u16 address, u16 length                 -> bytes
+//    5 GetFramebuffer                                         -> u8 width, u8 height, per plane height rows of width/8 bytes
+//    6 SaveState      u8 slot (0-15)
+//    7 RestoreState   u8 slot
+//    8 GetRegisters                                           -> V0-VF, u16 I, u16 PC, u8 SP, u8 DT, u8 ST
+//    9 Step           u16 keys, u32 frames, u8 1 to add the framebuffer
+//                                                             -> RunFrames response, then GetFramebuffer's if asked for
+
+namespace Emu8
+{
+	enum class Command : unsigned char
+	{
+		LoadRom = 1,
+		SetKeys = 2,
+		RunFrames = 3,
+		ReadMemory = 4,
+		GetFramebuffer = 5,
+		SaveState = 6,
+		RestoreState = 7,
+		GetRegisters = 8,
+		Step = 9
+	};
+
+	enum class Status : unsigned char
+	{
+		Ok = 0,
+		NoRom = 1,
+		BadRequest = 2,
+		LoadFailed = 3,
+		EmptySlot = 4
+	};
+
+	struct ClientSession
+	{
+		int socket;
+		std::vector<unsigned char> input;
+		std::vector<unsigned char> output;
+		size_t outputSent;
+		uint32_t watchedEvents;
+		std::unique_ptr<Machine> machine;
+		uint16_t keys;
+		std::array<std::unique_ptr<MachineState>, 16> slots;
+	};
+
+	class Server
+	{
+	private:
+		static const unsigned int MAX_MESSAGE_SIZE = 1 << 20;
+		static const unsigned int MAX_PENDING_OUTPUT = 8 << 20; //Stop reading requests until the client catches up.
+		static const unsigned int READ_CHUNK = 64 << 10;
+		static const unsigned int MAX_FRAMES = 3600; //A minute of game time, so no one request holds up the loop for long.
+
+		int listenSocket;
+		int epoll;
+		unsigned int maxClients;
+		std::map<int, std::unique_ptr<ClientSession>> sessions;
+
+		static void Log(std::string text);
+		static void AppendU16(std::vector<unsigned char>& out, uint16_t value);
+		static void AppendU32(std::vector<unsigned char>& out, uint32_t value);
+		static void AppendU64(std::vector<unsigned char>& out, uint64_t value);
+		static uint16_t ReadU16(const unsigned char* data);
+		static uint32_t ReadU32(const unsigned char* data);
+
+		void acceptClients();
+		void closeSession(ClientSession& session);
+		bool readInput(ClientSession& session);
+		bool writeOutput(ClientSession& session);
+		bool processInput(ClientSession& session);
+		void handleRequest(ClientSession& session, Command command, const unsigned char* payload, unsigned int length);
+		void runFrames(ClientSession& session, uint32_t frames);
+		void appendFramebuffer(ClientSession& session);
+
+	public:
+		Server(unsigned int maxClients);
+		~Server();
+		bool listen(std::string path);
+		void run(volatile std::sig_atomic_t& stopRequested);
+	};
+
+	Server::Server(unsigned int maxClients)
+			: listenSocket(-1), epoll(-1), maxClients(maxClients), sessions()
+	{
+	}
+
+	Server::~Server()
+	{
+		for(auto& entry : sessions)
+		{
+			::close(entry.first);
+		}
+		if(listenSocket >= 0)
+		{
+			::close(listenSocket);
+		}
+		if(epoll >= 0)
+		{
+			::close(epoll);
+		}
+	}
+
+	bool Server::listen(std::string path)
+	{
+		sockaddr_un address = {};
+		address.sun_family = AF_UNIX;
+		if(path.size() >= sizeof(address.sun_path))
+		{
+			Log("Socket path " + path + " is too long.");
+			return false;
+		}
+		std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+		//A socket file left behind by an earlier run would make bind fail.
+		::unlink(path.c_str());
+
+		listenSocket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if(listenSocket < 0 || epoll < 0 || ::bind(listenSocket, (sockaddr*)&address, sizeof(address)) < 0 || ::listen(listenSocket, SOMAXCONN) < 0)
+		{
+			Log("Could not listen on " + path + ": " + std::strerror(errno));
+			return false;
+		}
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = listenSocket;
+		return ::epoll_ctl(epoll, EPOLL_CTL_ADD, listenSocket, &event) == 0;
+	}
+
+	void Server::run(volatile std::sig_atomic_t& stopRequested)
+	{
+		std::vector<epoll_event> events(256);
+
+		while(!stopRequested)
+		{
+			int count = ::epoll_wait(epoll, events.data(), (int)events.size(), -1);
+			if(count < 0)
+			{
+				if(errno == EINTR)
+				{
+					continue;
+				}
+				Log(std::string("epoll_wait failed: ") + std::strerror(errno));
+				return;
+			}
+
+			for(int i = 0; i < count; i++)
+			{
+				if(events[i].data.fd == listenSocket)
+				{
+					acceptClients();
+					continue;
+				}
+
+				auto found = sessions.find(events[i].data.fd);
+				if(found == sessions.end())
+				{
+					continue;
+				}
+
+				ClientSession& session = *found->second;
+				bool open = !(events[i].events & (EPOLLERR | EPOLLHUP)) || (events[i].events & EPOLLIN);
+
+				if(open && (events[i].events & EPOLLOUT))
+				{
+					open = writeOutput(session) && processInput(session);
+				}
+				if(open && (events[i].events & EPOLLIN))
+				{
+					open = readInput(session) && processInput(session);
+				}
+				if(open)
+				{
+					open = writeOutput(session);
+				}
+
+				if(!open)
+				{
+					closeSession(session);
+				}
+			}
+		}
+	}
+
+	void Server::acceptClients()
+	{
+		while(true)
+		{
+			int client = ::accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if(client < 0)
+			{
+				return;
+			}
+
+			if(sessions.size() >= maxClients)
+			{
+				::close(client);
+				continue;
+			}
+
+			std::unique_ptr<ClientSession> session(new ClientSession());
+			session->socket = client;
+			session->outputSent = 0;
+			session->watchedEvents = EPOLLIN;
+			session->keys = 0;
+
+			epoll_event event = {};
+			event.events = EPOLLIN;
+			event.data.fd = client;
+			if(::epoll_ctl(epoll, EPOLL_CTL_ADD, client, &event) < 0)
+			{
+				::close(client);
+				continue;
+			}
+
+			sessions[client] = std::move(session);
+		}
+	}
+
+	void Server::closeSession(ClientSession& session)
+	{
+		int socket = session.socket;
+
+		::epoll_ctl(epoll, EPOLL_CTL_DEL, socket, nullptr);
+		::close(socket);
+		sessions.erase(socket);
+	}
+
+	bool Server::readInput(ClientSession& session)
+	{
+		//Leave whatever does not fit under the output limit in the socket until the client reads its responses.
+		while(session.output.size() - session.outputSent < MAX_PENDING_OUTPUT)
+		{
+			size_t used = session.input.size();
+			session.input.resize(used + READ_CHUNK);
+
+			ssize_t received = ::recv(session.socket, session.input.data() + used, READ_CHUNK, 0);
+			session.input.resize(used + (received > 0 ? (size_t)received : 0));
+
+			if(received == 0)
+			{
+				return false;
+			}
+			if(received < 0)
+			{
+				return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+			}
+			if(session.input.size() > MAX_MESSAGE_SIZE + 4 && !processInput(session))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool Server::writeOutput(ClientSession& session)
+	{
+		while(session.outputSent < session.output.size())
+		{
+			ssize_t sent = ::send(session.socket, session.output.data() + session.outputSent, session.output.size() - session.outputSent, MSG_NOSIGNAL);
+			if(sent < 0)
+			{
+				if(errno == EAGAIN || errno == EWOULDBLOCK)
+				{
+					break;
+				}
+				if(errno == EINTR)
+				{
+					continue;
+				}
+				return false;
+			}
+			session.outputSent += (size_t)sent;
+		}
+
+		if(session.outputSent == session.output.size())
+		{
+			session.output.clear();
+			session.outputSent = 0;
+		}
+
+		//Epoll is level triggered, so only ask for writability while there is something waiting to go out, and stop
+		//asking for input while too much is, or either would keep firing with nothing to do.
+		uint32_t events = (session.output.size() - session.outputSent < MAX_PENDING_OUTPUT ? (uint32_t)EPOLLIN : 0u) | (session.output.empty() ? 0u : (uint32_t)EPOLLOUT);
+		if(events != session.watchedEvents)
+		{
+			epoll_event event = {};
+			event.events = events;
+			event.data.fd = session.socket;
+			::epoll_ctl(epoll, EPOLL_CTL_MOD, session.socket, &event);
+			session.watchedEvents = events;
+		}
+		return true;
+	}
+
+	bool Server::processInput(ClientSession& session)
+	{
+		size_t offset = 0;
+
+		while(session.input.size() - offset >= 4 && session.output.size() - session.outputSent < MAX_PENDING_OUTPUT)
+		{
+			uint32_t length = ReadU32(&session.input[offset]);
+			if(length == 0 || length > MAX_MESSAGE_SIZE)
+			{
+				return false;
+			}
+			if(session.input.size() - offset - 4 < length)
+			{
+				break;
+			}
+
+			const unsigned char* message = &session.input[offset + 4];
+			handleRequest(session, (Command)message[0], message + 1, length - 1);
+			offset += 4 + length;
+		}
+
+		session.input.erase(session.input.begin(), session.input.begin() + offset);
+		return true;
+	}
+
+	void Server::handleRequest(ClientSession& session, Command command, const unsigned char* payload, unsigned int length)
+	{
+		std::vector<unsigned char>& out = session.output;
+		size_t start = out.size();
+		Status status = Status::Ok;
+
+		AppendU32(out, 0);
+		out.push_back((unsigned char)command);
+		out.push_back((unsigned char)Status::Ok);
+
+		if(command != Command::LoadRom && session.machine == nullptr)
+		{
+			status = Status::NoRom;
+		}
+		else
+		{
+			switch(command)
+			{
+				case Command::LoadRom:
+				{
+					const Profile profiles[] = {Profile::CosmacVip, Profile::Chip48, Profile::SuperChip, Profile::XoChip};
+					if(length < 1 || payload[0] > 3)
+					{
+						status = Status::BadRequest;
+						break;
+					}
+
+					std::unique_ptr<Machine> machine = Machine::Create(profiles[payload[0]]);
+					if(!machine->loadGame(payload + 1, length - 1))
+					{
+						status = Status::LoadFailed;
+						break;
+					}
+					session.machine = std::move(machine);
+					session.keys = 0;
+					for(std::unique_ptr<MachineState>& slot : session.slots)
+					{
+						slot.reset();
+					}
+					break;
+				}
+				case Command::SetKeys:
+				{
+					if(length != 2)
+					{
+						status = Status::BadRequest;
+						break;
+					}
+					session.keys = ReadU16(payload);
+					break;
+				}
+				case Command::RunFrames:
+				{
+					if(length != 4 || ReadU32(payload) > MAX_FRAMES)
+					{
+						status = Status::BadRequest;
+						break;
+					}
+					runFrames(session, ReadU32(payload));
+					break;
+				}
+				case Command::ReadMemory:
+				{
+					if(length != 4)
+					{
+						status = Status::BadRequest;
+						break;
+					}
+					const MachineState& state = session.machine->getState();
+					unsigned int address = ReadU16(payload);
+					unsigned int count = std::min<unsigned int>(ReadU16(payload + 2), (unsigned int)state.mainMem.size() - address);
+					out.insert(out.end(), state.mainMem.begin() + address, state.mainMem.begin() + address + count);
+					break;
+				}
+				case Command::GetFramebuffer:
+				{
+					appendFramebuffer(session);
+					break;
+				}
+				case Command::SaveState:
+				case Command::RestoreState:
+				{
+					if(length != 1 || payload[0] >= session.slots.size())
+					{
+						status = Status::BadRequest;
+						break;
+					}
+
+					std::unique_ptr<MachineState>& slot = session.slots[payload[0]];
+					if(command == Command::SaveState)
+					{
+						if(slot == nullptr)
+						{
+							slot.reset(new MachineState());
+						}
+						session.machine->saveState(*slot);
+					}
+					else if(slot == nullptr)
+					{
+						status = Status::EmptySlot;
+					}
+					else
+					{
+						session.machine->restoreState(*slot);
+					}
+					break;
+				}
+				case Command::GetRegisters:
+				{
+					const MachineState& state = session.machine->getState();
+					out.insert(out.end(), state.vReg.begin(), state.vReg.end());
+					AppendU16(out, state.iRegister);
+					AppendU16(out, state.programCounter);
+					out.push_back(state.stackPointer);
+					out.push_back(state.delayRegister);
+					out.push_back(state.soundRegister);
+					break;
+				}
+				case Command::Step:
+				{
+					if(length != 7 || ReadU32(payload + 2) > MAX_FRAMES)
+					{
+						status = Status::BadRequest;
+						break;
+					}
+					session.keys = ReadU16(payload);
+					runFrames(session, ReadU32(payload + 2));
+					if(payload[6] & 1)
+					{
+						appendFramebuffer(session);
+					}
+					break;
+				}
+				default:
+				{
+					status = Status::BadRequest;
+					break;
+				}
+			}
+		}
+
+		//A failed request answers with the status alone.
+		if(status != Status::Ok)
+		{
+			out.resize(start + 6);
+			out[start + 5] = (unsigned char)status;
+		}
+
+		uint32_t responseLength = (uint32_t)(out.size() - start - 4);
+		for(unsigned int i = 0; i < 4; i++)
+		{
+			out[start + i] = (unsigned char)(responseLength >> (i * 8));
+		}
+	}
+
+	void Server::runFrames(ClientSession& session, uint32_t frames)
+	{
+		Machine& machine = *session.machine;
+
+		for(unsigned char key = 0; key < 16; key++)
+		{
+			machine.setKey(key, (session.keys >> key) & 1);
+		}
+
+		//Fx0A takes the lowest key held, with nothing held the program just waits out the frames.
+		for(uint32_t frame = 0; frame < frames && !machine.isHalted(); frame++)
+		{
+			if(machine.isWaitingForKey() && session.keys != 0)
+			{
+				unsigned char key = 0;
+				while(!((session.keys >> key) & 1))
+				{
+					key++;
+				}
+				machine.provideKey(key);
+			}
+			machine.runFrame();
+		}
+
+		session.output.push_back((unsigned char)((machine.isHalted() ? 1 : 0) | (machine.isWaitingForKey() ? 2 : 0)));
+		AppendU64(session.output, machine.getStats().instructionsExecuted + machine.getStats().instructionsSkipped);
+	}
+
+	void Server::appendFramebuffer(ClientSession& session)
+	{
+		//Rows are sent as packed bits with the leftmost pixel in the most significant bit, as they are stored.
+		const Framebuffer& framebuffer = session.machine->getState().framebuffer;
+		std::vector<unsigned char>& out = session.output;
+
+		out.push_back((unsigned char)framebuffer.getWidth());
+		out.push_back((unsigned char)framebuffer.getHeight());
+
+		for(unsigned int plane = 0; plane < Framebuffer::PLANE_COUNT; plane++)
+		{
+			for(unsigned int y = 0; y < framebuffer.getHeight(); y++)
+			{
+				const uint64_t* row = framebuffer.getRow(plane, y);
+				for(unsigned int byte = 0; byte < framebuffer.getWidth() / 8; byte++)
+				{
+					out.push_back((unsigned char)(row[byte / 8] >> (56 - (byte % 8) * 8)));
+				}
+			}
+		}
+	}
+
+	void Server::Log(std::string text)
+	{
+		//Console stays off the rest of the time, hundreds of machines beeping would drown out everything else.
+		Console::SetEnabled(true);
+		Console::Print(text);
+		Console::SetEnabled(false);
+	}
+
+	void Server::AppendU16(std::vector<unsigned char>& out, uint16_t value)
+	{
+		out.push_back((unsigned char)value);
+		out.push_back((unsigned char)(value >> 8));
+	}
+
+	void Server::AppendU32(std::vector<unsigned char>& out, uint32_t value)
+	{
+		AppendU16(out, (uint16_t)value);
+		AppendU16(out, (uint16_t)(value >> 16));
+	}
+
+	void Server::AppendU64(std::vector<unsigned char>& out, uint64_t value)
+	{
+		AppendU32(out, (uint32_t)value);
+		AppendU32(out, (uint32_t)(value >> 32));
+	}
+
+	uint16_t Server::ReadU16(const unsigned char* data)
+	{
+		return (uint16_t)(data[0] | (data[1] << 8));
+	}
+
+	uint32_t Server::ReadU32(const unsigned char* data)
+	{
+		return (uint32_t)ReadU16(data) | ((uint32_t)ReadU16(data + 2) << 16);
+	}
+}
+
+namespace
+{
+	volatile std::sig_atomic_t stopRequested = 0;
+
+	void RequestStop(int)
+	{
+		stopRequested = 1;
+	}
+}
+
+int main(int argc, char* args[])
+{
+	if(argc < 2)
+	{
+		Emu8::Console::Print("Usage: emu8_server <socket path> [max clients]");
+		return 1;
+	}
+
+	unsigned int maxClients = argc > 2 ? (unsigned int)std::strtoul(args[2], nullptr, 10) : 1024;
+	Emu8::Server server(maxClients);
+	if(!server.listen(args[1]))
+	{
+		return 1;
+	}
+
+	std::signal(SIGINT, RequestStop);
+	std::signal(SIGTERM, RequestStop);
+
+	Emu8::Console::Print("Listening on " + std::string(args[1]) + ".");
+	Emu8::Console::SetEnabled(false);
+	server.run(stopRequested);
+
+	::unlink(args[1]);
+	return 0;
+}
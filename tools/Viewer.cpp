@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+#include <dirent.h>
+#include <memory>
+#include <SDL.h>
+#include <string>
+#include <vector>
+#include "Console.h"
+#include "Display.h"
+#include "SharedExport.h"
+
+//Reference viewer for machines shared with EMU8_SHARED. It maps each segment read only and tiles the frames into one
+//window, it never blocks the machines it watches: a frame that is being written while it is read is retried, and
+//if the writer stays busy the tile keeps its previous frame.
+//
+//Usage: emu8_viewer [name...], with no names every /emu8-* segment is shown and the list is refreshed once a second.
+
+namespace Emu8
+{
+	struct Tile
+	{
+		std::string name;
+		std::unique_ptr<SharedExport> segment;
+		SharedMachineData data;
+		bool hasData;
+	};
+
+	class Viewer
+	{
+	private:
+		static const unsigned int WINDOW_WIDTH = 1280;
+		static const unsigned int WINDOW_HEIGHT = 720;
+		static const unsigned int FRAMES_PER_SECOND = 60;
+
+		std::vector<Tile> tiles;
+		std::vector<std::string> fixedNames;
+		SDL_Surface* tileSurface;
+
+		static std::vector<std::string> FindSegments()
+		{
+			//Linux keeps POSIX shared memory in /dev/shm, elsewhere the names have to be given.
+			std::vector<std::string> names;
+			DIR* directory = opendir("/dev/shm");
+			if(directory == nullptr)
+			{
+				return names;
+			}
+
+			std::string prefix = std::string(SharedExport::NAME_PREFIX).substr(1);
+			while(dirent* entry = readdir(directory))
+			{
+				std::string name = entry->d_name;
+				if(name.compare(0, prefix.size(), prefix) == 0)
+				{
+					names.push_back(name.substr(prefix.size()));
+				}
+			}
+			closedir(directory);
+
+			std::sort(names.begin(), names.end());
+			return names;
+		}
+
+		void refreshTiles()
+		{
+			std::vector<std::string> names = fixedNames.empty() ? FindSegments() : fixedNames;
+			std::vector<Tile> refreshed;
+
+			for(std::string& name : names)
+			{
+				auto existing = std::find_if(tiles.begin(), tiles.end(), [&](const Tile& tile) { return tile.name == name; });
+				if(existing != tiles.end())
+				{
+					refreshed.push_back(std::move(*existing));
+					continue;
+				}
+
+				Tile tile = {name, std::unique_ptr<SharedExport>(new SharedExport()), SharedMachineData(), false};
+				if(tile.segment->attach(name))
+				{
+					Console::Print("Watching " + name + ".");
+					refreshed.push_back(std::move(tile));
+				}
+			}
+
+			tiles = std::move(refreshed);
+		}
+
+		void drawTile(Tile& tile, SDL_Rect area)
+		{
+			if(tile.segment->read(tile.data))
+			{
+				tile.hasData = true;
+			}
+			if(!tile.hasData)
+			{
+				return;
+			}
+
+			Display::DrawFrame(tileSurface, tile.data.planes[0], tile.data.planes[1], (tile.data.flags & SharedMachineData::HI_RES) != 0);
+			SDL_BlitScaled(tileSurface, nullptr, Display::GetWindowSurface(), &area);
+
+			if(tile.data.flags & SharedMachineData::HALTED)
+			{
+				Display::DrawHaltedBar(area);
+			}
+		}
+
+	public:
+		Viewer(std::vector<std::string> names)
+				: tiles(), fixedNames(names), tileSurface(nullptr)
+		{
+		}
+
+		~Viewer()
+		{
+			SDL_FreeSurface(tileSurface);
+			Display::Destroy();
+			SDL_Quit();
+		}
+
+		bool init()
+		{
+			if(SDL_Init(SDL_INIT_VIDEO) < 0 || !Display::Create(WINDOW_WIDTH, WINDOW_HEIGHT))
+			{
+				Console::Print("Failed to open a window!");
+				return false;
+			}
+
+			tileSurface = SDL_CreateRGBSurface(0, Framebuffer::MAX_WIDTH, Framebuffer::MAX_HEIGHT, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+			return tileSurface != nullptr;
+		}
+
+		void run()
+		{
+			Uint32 lastRefresh = 0;
+			bool isRunning = true;
+
+			while(isRunning)
+			{
+				Uint32 frameStart = SDL_GetTicks();
+
+				SDL_Event event;
+				while(SDL_PollEvent(&event))
+				{
+					if(event.type == SDL_QUIT)
+					{
+						isRunning = false;
+					}
+				}
+
+				if(tiles.empty() || frameStart - lastRefresh >= 1000)
+				{
+					refreshTiles();
+					lastRefresh = frameStart;
+				}
+
+				SDL_Surface* windowSurface = Display::GetWindowSurface();
+				SDL_FillRect(windowSurface, nullptr, SDL_MapRGB(windowSurface->format, 32, 32, 32));
+
+				for(unsigned int i = 0; i < tiles.size(); i++)
+				{
+					drawTile(tiles[i], Display::GetTileArea(i, (unsigned int)tiles.size()));
+				}
+
+				Display::Flip();
+
+				Uint32 elapsed = SDL_GetTicks() - frameStart;
+				if(elapsed < 1000 / FRAMES_PER_SECOND)
+				{
+					SDL_Delay(1000 / FRAMES_PER_SECOND - elapsed);
+				}
+			}
+		}
+	};
+}
+
+int main(int argc, char* argv[])
+{
+	Emu8::Console::SetEnabled(true);
+
+	Emu8::Viewer viewer(std::vector<std::string>(argv + 1, argv + argc));
+	if(!viewer.init())
+	{
+		return 1;
+	}
+
+	viewer.run();
+	return 0;
+}